@@ -0,0 +1,86 @@
+#!/usr/bin/env python
+
+# callblocker - blocking unwanted calls from your home phone
+# Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 3
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+#
+
+# Runs a script of callblockerd as long-lived worker, so the interpreter and
+# the modules of the script are only loaded once. Each request is a JSON line
+# {"args": [...]} on stdin: main() of the script is called with these arguments
+# and its output is answered as JSON line {"exit": N, "output": "..."} on stdout.
+# The worker ends at the end of its input.
+
+from __future__ import print_function
+import os, sys, imp, traceback
+import StringIO
+import json
+
+
+def run(module, path, args):
+  output = StringIO.StringIO()
+  stdout, stderr = sys.stdout, sys.stderr
+  sys.stdout = sys.stderr = output
+  sys.argv = [path] + args
+  code = 0
+  try:
+    module.main(sys.argv)
+  except SystemExit as e:
+    if e.code is None: code = 0
+    elif isinstance(e.code, int): code = e.code
+    else: code = 1
+  except Exception:
+    traceback.print_exc()
+    code = 1
+  finally:
+    sys.stdout, sys.stderr = stdout, stderr
+  try:
+    text = output.getvalue()
+  except UnicodeError:
+    return (1, "invalid output encoding")
+  return (code, text.strip())
+
+#
+# main
+#
+def main(argv):
+  if len(argv) != 2:
+    print("usage: " + argv[0] + " <script>", file=sys.stderr)
+    sys.exit(-1)
+  path = argv[1]
+  name = os.path.splitext(os.path.basename(path))[0]
+  # the scripts import each other
+  sys.path.insert(0, os.path.dirname(os.path.abspath(path)))
+  module = imp.load_source(name, path)
+
+  while True:
+    line = sys.stdin.readline()
+    if not line:
+      break
+    try:
+      args = json.loads(line)["args"]
+    except (ValueError, KeyError, TypeError):
+      args = None
+    if args is None:
+      code, text = (1, "invalid request")
+    else:
+      code, text = run(module, path, args)
+    sys.stdout.write(json.dumps({"exit": code, "output": text}) + "\n")
+    sys.stdout.flush()
+
+if __name__ == "__main__":
+    main(sys.argv)
+    sys.exit(0)
@@ -26,6 +26,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <poll.h>
+#include <sys/eventfd.h>
 
 #include <boost/regex.hpp>
 #include <boost/lexical_cast.hpp>
@@ -54,10 +55,31 @@ AnalogPhone::AnalogPhone(Block* pBlock) : Phone(pBlock) {
   Logger::debug("AnalogPhone::AnalogPhone()...");
   m_numRings = 0;
   m_foundCID = false;
+  m_callId = 0;
+  m_stopping = false;
+  m_decisionFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_decisionFD < 0) {
+    Logger::warn("eventfd failed (%s)", strerror(errno));
+  }
+  m_worker = std::thread(&AnalogPhone::runWorker, this);
 }
 
 AnalogPhone::~AnalogPhone() {
   Logger::debug("AnalogPhone::~AnalogPhone()...");
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    for (size_t i = 0; i < m_requests.size(); i++) {
+      Logger::info("call of %s not decided, the phone was removed", m_requests[i].number.c_str());
+    }
+    m_requests.clear();
+  }
+  m_cond.notify_all();
+  m_worker.join(); // a decision being taken no longer waits for scripts, so the main loop is not held up
+  if (m_decisionFD >= 0) {
+    close(m_decisionFD);
+    m_decisionFD = -1;
+  }
 }
 
 bool AnalogPhone::init(struct SettingAnalogPhone* phone) {
@@ -77,9 +99,19 @@ bool AnalogPhone::init(struct SettingAnalogPhone* phone) {
   return true;
 }
 
-// load this into a seperate thread, needed for LiveAPI access, which may take some time...,
-// or offload LiveAPI access itself into a seperate thread? YES?
+// the main loop calls run(), when one of these is readable
+std::vector<int> AnalogPhone::getFDs() {
+  std::vector<int> res;
+  res.push_back(m_modem.getFD());
+  res.push_back(m_ringTimer.getFD());
+  res.push_back(m_hangupTimer.getFD());
+  res.push_back(m_decisionFD);
+  return res;
+}
+
 void AnalogPhone::run() {
+  handleDecisions();
+
   std::string data;
   if (m_modem.getData(&data)) {
     if (data == "RING") {
@@ -103,7 +135,6 @@ void AnalogPhone::run() {
       // NMBR=0123456789
       // NAME=aasdasdd
 
-      bool block = false;
       std::vector<std::string> lines;
       boost::split(lines, data, boost::is_any_of("\n"));
       for (size_t i = 0; i < lines.size(); i++) {
@@ -116,32 +147,11 @@ void AnalogPhone::run() {
 
           if (key == "NMBR") {
             m_foundCID = true;
-            std::string number = value;
-
-            if (number == "PRIVATE") {
-              // Caller ID information has been blocked by the user of the other end
-              // see http://ads.usr.com/support/3453c/3453c-ug/dial_answer.html#IDfunctions
-              std::string msg;
-              block = isAnonymousNumberBlocked(&m_settings.base, &msg);
-              Logger::notice(msg.c_str());
-              break;
-            }
-
-            // make number international
-            number = Helper::makeNumberInternational(&m_settings.base, number);
-
-            std::string msg;
-            block = isNumberBlocked(&m_settings.base, number, &msg);
-            Logger::notice(msg.c_str());
+            decide(value);
             break;
           }
         }
       } // for    
-
-      if (block) {
-        m_modem.sendCommand(AT_PICKUP_STR); // pickup
-        m_hangupTimer.restart(PICKUP_HANGUP_TIME_SEC);
-      }
     }
   }
 
@@ -151,6 +161,7 @@ void AnalogPhone::run() {
     m_ringTimer.stop();
     m_numRings = 0;
     m_foundCID = false;
+    m_callId++;
   }
 
   // hangup
@@ -161,3 +172,70 @@ void AnalogPhone::run() {
   }
 }
 
+// the decision is taken by the worker, it is handled by run() when done
+void AnalogPhone::decide(const std::string& rNumber) {
+  struct AnalogPhoneCall call;
+  call.id = m_callId;
+  call.number = rNumber;
+  call.block = false;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_requests.push_back(call);
+  }
+  m_cond.notify_all();
+}
+
+void AnalogPhone::runWorker() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_cond.wait(lock, [this] { return m_stopping || !m_requests.empty(); });
+    if (m_stopping) {
+      break;
+    }
+    struct AnalogPhoneCall call = m_requests.front();
+    m_requests.pop_front();
+    lock.unlock();
+
+    std::string msg;
+    if (call.number == "PRIVATE") {
+      // Caller ID information has been blocked by the user of the other end
+      // see http://ads.usr.com/support/3453c/3453c-ug/dial_answer.html#IDfunctions
+      call.block = isAnonymousNumberBlocked(&m_settings.base, &m_stopping, &msg);
+    } else {
+      // make number international
+      std::string number = Helper::makeNumberInternational(&m_settings.base, call.number);
+      call.block = isNumberBlocked(&m_settings.base, number, &m_stopping, &msg);
+    }
+    Logger::notice(msg.c_str());
+
+    lock.lock();
+    m_decisions.push_back(call);
+    uint64_t one = 1;
+    if (write(m_decisionFD, &one, sizeof(one)) != sizeof(one)) {
+      Logger::warn("eventfd write failed (%s)", strerror(errno));
+    }
+  }
+}
+
+void AnalogPhone::handleDecisions() {
+  uint64_t count;
+  (void)read(m_decisionFD, &count, sizeof(count));
+
+  std::deque<struct AnalogPhoneCall> decisions;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    decisions.swap(m_decisions);
+  }
+  for (size_t i = 0; i < decisions.size(); i++) {
+    if (!decisions[i].block) {
+      continue;
+    }
+    if (decisions[i].id != m_callId) {
+      Logger::debug("call of %s already ended, not blocked anymore", decisions[i].number.c_str());
+      continue;
+    }
+    m_modem.sendCommand(AT_PICKUP_STR); // pickup
+    m_hangupTimer.restart(PICKUP_HANGUP_TIME_SEC);
+  }
+}
+
@@ -21,36 +21,62 @@
 #define ANALOGPHONE_H
 
 #include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include <termios.h>
-#include <sys/time.h>
+#include <sys/timerfd.h>
 
 #include "Phone.h"
 #include "Modem.h"
 
 
+// a timerfd, so the main loop wakes up when the timer elapses
 class Timer {
 private:
+  int m_FD;
   bool m_active;
-  struct timeval elapseTime;
+  struct timespec m_elapseTime;
 
 public:
   Timer() {
+    m_FD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
     m_active = false;
-    timerclear(&elapseTime);
+    m_elapseTime.tv_sec = m_elapseTime.tv_nsec = 0;
+  }
+
+  virtual ~Timer() {
+    if (m_FD >= 0) {
+      close(m_FD);
+      m_FD = -1;
+    }
+  }
+
+  int getFD() {
+    return m_FD;
   }
 
   void restart(time_t elapseSec) {
-    struct timeval add;
-    timerclear(&add);
-    add.tv_sec = elapseSec;
-    getCurrent(&elapseTime);
-    timeradd(&elapseTime, &add, &elapseTime);
+    (void)clock_gettime(CLOCK_MONOTONIC, &m_elapseTime);
+    m_elapseTime.tv_sec += elapseSec;
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value = m_elapseTime;
+    (void)timerfd_settime(m_FD, TFD_TIMER_ABSTIME, &spec, NULL);
     m_active = true;
   }
 
   void stop(void) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    (void)timerfd_settime(m_FD, 0, &spec, NULL); // disarms and clears an expiration not read yet
     m_active = false;
-    timerclear(&elapseTime);
   }
 
   bool isActive() {
@@ -58,21 +84,20 @@ public:
   }
 
   bool hasElapsed() {
-    struct timeval now;
-    getCurrent(&now);
-    return timercmp(&elapseTime, &now, <=) ? true : false;
-  }
-
-private:
-  static void getCurrent(struct timeval* res) {
-    struct timespec tp;
-    (void)clock_gettime(CLOCK_MONOTONIC, &tp);
-    res->tv_sec = tp.tv_sec;
-    res->tv_usec = tp.tv_nsec / 1000;
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > m_elapseTime.tv_sec ||
+      (now.tv_sec == m_elapseTime.tv_sec && now.tv_nsec >= m_elapseTime.tv_nsec);
   }
 };
 
 
+struct AnalogPhoneCall {
+  unsigned int id;      // of the call, a decision for an earlier call is dropped
+  std::string number;   // "PRIVATE" if anonymous
+  bool block;           // decision of the worker
+};
+
 class AnalogPhone : public Phone {
 private:
   struct SettingAnalogPhone m_settings;
@@ -82,14 +107,30 @@ private:
   Timer m_ringTimer;
   unsigned int m_numRings;
   bool m_foundCID;
+  unsigned int m_callId;
 
   Timer m_hangupTimer;
 
+  // the decisions are taken by a worker, so a slow online check does not hold up the main loop
+  std::thread m_worker;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<struct AnalogPhoneCall> m_requests;
+  std::deque<struct AnalogPhoneCall> m_decisions;
+  std::atomic<bool> m_stopping;  // also stops a decision waiting for scripts
+  int m_decisionFD;  // eventfd, readable when there are decisions
+
 public:
   AnalogPhone(Block* pBlock);
   virtual ~AnalogPhone();
   bool init(struct SettingAnalogPhone* pPhone);
+  std::vector<int> getFDs();
   void run();
+
+private:
+  void decide(const std::string& rNumber);
+  void runWorker();
+  void handleDecisions();
 };
 
 #endif
@@ -0,0 +1,914 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+// Benchmarks of the list handling, run with "make bench".
+// Each result is printed as one JSON object per line.
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "Logger.h"
+#include "FileList.h"
+#include "ListParser.h"
+#include "FileLists.h"
+#include "ListIndex.h"
+#include "NumberTrie.h"
+#include "PackedNumber.h"
+#include "Block.h"
+
+
+// realistic looking numbers, so the index gets shared prefixes like real lists:
+// most numbers have a few mobile and city prefixes of the home country, with the
+// length of a full E.164 number of the prefix's country
+struct BenchPrefix {
+  const char* prefix;
+  unsigned int weight;
+  size_t length;
+};
+
+static std::string randomNumber(std::mt19937* pRandom) {
+  static const struct BenchPrefix s_prefixes[] = {
+    {"+4179", 20, 12}, {"+4178", 12, 12}, {"+4176", 10, 12}, {"+4144", 10, 12}, {"+4143", 6, 12},
+    {"+4122", 6, 12}, {"+4131", 4, 12}, {"+4161", 4, 12}, {"+41800", 2, 12}, {"+41900", 2, 12},
+    {"+4915", 5, 13}, {"+4917", 5, 13}, {"+4930", 3, 12}, {"+4989", 2, 12}, {"+3906", 3, 12},
+    {"+33", 3, 12}, {"+1", 3, 12}};
+  static unsigned int s_totalWeight = 0;
+  if (s_totalWeight == 0) {
+    for(size_t i = 0; i < sizeof(s_prefixes) / sizeof(s_prefixes[0]); i++) s_totalWeight += s_prefixes[i].weight;
+  }
+  unsigned int r = (*pRandom)() % s_totalWeight;
+  size_t p = 0;
+  while (r >= s_prefixes[p].weight) {
+    r -= s_prefixes[p].weight;
+    p++;
+  }
+  std::string number = s_prefixes[p].prefix;
+  while (number.length() < s_prefixes[p].length) {
+    number.push_back('0' + (*pRandom)() % 10);
+  }
+  return number;
+}
+
+// most entries of real lists carry one of a few labels, the others an individual name
+static std::string randomName(std::mt19937* pRandom) {
+  static const char* s_labels[] = {"Telemarketing", "Spam", "Robocall", "Debt collector", "Survey", "Insurance", "Energy supplier", "Unknown"};
+  unsigned int r = (*pRandom)() % 100;
+  if (r < 80) {
+    return s_labels[r % (sizeof(s_labels) / sizeof(s_labels[0]))];
+  }
+  return "Caller " + std::to_string((*pRandom)() % 100000);
+}
+
+static bool writeList(const std::string& rFilename, size_t numEntries, std::mt19937* pRandom) {
+  FILE* f = fopen(rFilename.c_str(), "w");
+  if (f == NULL) {
+    return false;
+  }
+  fprintf(f, "{\n  \"name\": \"%s\",\n  \"entries\": [\n", rFilename.c_str());
+  for(size_t i = 0; i < numEntries; i++) {
+    // number first, writeLists() repeats the sequence
+    std::string number = randomNumber(pRandom);
+    std::string name = randomName(pRandom);
+    fprintf(f, "    {\"number\": \"%s\", \"name\": \"%s\", \"date_created\": \"2015-01-01 00:00:00 +0000\"}%s\n",
+      number.c_str(), name.c_str(), i + 1 < numEntries ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+  return fclose(f) == 0;
+}
+
+static void removeDirectory(const std::string& rPathname) {
+  DIR* dir = opendir(rPathname.c_str());
+  if (dir == NULL) {
+    return;
+  }
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+    std::string name = rPathname + "/" + entry->d_name;
+    if (entry->d_type & DT_DIR) removeDirectory(name);
+    else (void)unlink(name.c_str());
+  }
+  closedir(dir);
+  (void)rmdir(rPathname.c_str());
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// startup time of a list directory, loaded sequentially and in parallel
+static int benchLoad(size_t numFiles, size_t entriesPerFile) {
+  char tmpl[] = "/tmp/callblocker-bench-XXXXXX";
+  if (mkdtemp(tmpl) == NULL) {
+    fprintf(stderr, "creating temporary directory failed\n");
+    return 1;
+  }
+  std::string pathname = tmpl;
+  std::mt19937 random(42);
+  for(size_t i = 0; i < numFiles; i++) {
+    char filename[32];
+    snprintf(filename, sizeof(filename), "/list%03zu.json", i);
+    if (!writeList(pathname + filename, entriesPerFile, &random)) {
+      fprintf(stderr, "writing list failed\n");
+      removeDirectory(pathname);
+      return 1;
+    }
+  }
+
+  unsigned int threads[] = {1, 0};
+  for(size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+    // without the compiled index, all lists have to be parsed
+    removeDirectory(pathname + "/.cache");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    FileLists* lists = new FileLists(pathname, 0, threads[i]);
+    double ms = elapsedMs(start);
+    printf("{\"bench\": \"load\", \"threads\": \"%s\", \"files\": %zu, \"entries\": %zu, \"ms\": %.1f}\n",
+      threads[i] == 0 ? "auto" : "1", numFiles, numFiles * entriesPerFile, ms);
+    delete lists;
+  }
+
+  removeDirectory(pathname);
+  return 0;
+}
+
+static long getPeakRssKb() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return -1;
+  }
+  return usage.ru_maxrss;
+}
+
+// code pages and allocator state first touched by parsing, independent of the list size
+#define BENCH_PARSE_FIXED_RSS_KB  4096
+
+// peak memory of parsing one large list, measured in a child process,
+// so it is not hidden by the peak of generating the file. It fails when parsing
+// needs more than the compiled index of the list and the parser buffer.
+static int benchParse(size_t numEntries) {
+  char tmpl[] = "/tmp/callblocker-bench-XXXXXX";
+  if (mkdtemp(tmpl) == NULL) {
+    fprintf(stderr, "creating temporary directory failed\n");
+    return 1;
+  }
+  std::string pathname = tmpl;
+  std::string filename = pathname + "/list.json";
+  std::mt19937 random(42);
+  if (!writeList(filename, numEntries, &random)) {
+    fprintf(stderr, "writing list failed\n");
+    removeDirectory(pathname);
+    return 1;
+  }
+  struct stat st;
+  (void)stat(filename.c_str(), &st);
+
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    long before = getPeakRssKb();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    FileList* list = new FileList();
+    bool ok = list->load(filename);
+    double ms = elapsedMs(start);
+    long peak = getPeakRssKb();
+    std::vector<FileList*> lists(1, list);
+    std::string data;
+    ListIndex::create(lists, &data);
+    long limit = data.size() / 1024 + LISTPARSER_BUFFER_SIZE / 1024 + BENCH_PARSE_FIXED_RSS_KB;
+    printf("{\"bench\": \"parse\", \"entries\": %zu, \"file_kb\": %lld, \"ms\": %.1f, \"peak_rss_kb\": %ld, \"parse_rss_kb\": %ld, \"limit_kb\": %ld}\n",
+      list->getNumEntries(), (long long)st.st_size / 1024, ms, peak, peak - before, limit);
+    if (peak - before > limit) {
+      fprintf(stderr, "parsing needs %ld kB, more than the limit of %ld kB\n", peak - before, limit);
+      ok = false;
+    }
+    delete list;
+    fflush(stdout);
+    _exit(ok ? 0 : 1);
+  }
+  int status = 1;
+  if (pid < 0 || waitpid(pid, &status, 0) != pid) {
+    fprintf(stderr, "running parse child failed\n");
+  }
+  removeDirectory(pathname);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+static long getRssKb() {
+  long size = 0, resident = 0;
+  FILE* f = fopen("/proc/self/statm", "r");
+  if (f == NULL) {
+    return -1;
+  }
+  if (fscanf(f, "%ld %ld", &size, &resident) != 2) resident = -1;
+  fclose(f);
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// memory held by the entries of a loaded list and by its compiled index, per 100k entries
+static int benchMemory(size_t numEntries) {
+  char tmpl[] = "/tmp/callblocker-bench-XXXXXX";
+  if (mkdtemp(tmpl) == NULL) {
+    fprintf(stderr, "creating temporary directory failed\n");
+    return 1;
+  }
+  std::string pathname = tmpl;
+  std::string filename = pathname + "/list.json";
+  std::mt19937 random(42);
+  if (!writeList(filename, numEntries, &random)) {
+    fprintf(stderr, "writing list failed\n");
+    removeDirectory(pathname);
+    return 1;
+  }
+
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    long before = getRssKb();
+    FileList* list = new FileList();
+    bool ok = list->load(filename);
+    long rss = getRssKb() - before;
+    std::vector<FileList*> lists(1, list);
+    std::string data;
+    ListIndex::create(lists, &data);
+    double per100k = 100000.0 / numEntries;
+    printf("{\"bench\": \"memory\", \"entries\": %zu, \"list_kb_per_100k\": %.0f, \"index_kb_per_100k\": %.0f}\n",
+      numEntries, rss * per100k, data.size() / 1024.0 * per100k);
+    delete list;
+    fflush(stdout);
+    _exit(ok ? 0 : 1);
+  }
+  int status = 1;
+  if (pid < 0 || waitpid(pid, &status, 0) != pid) {
+    fprintf(stderr, "running memory child failed\n");
+  }
+  removeDirectory(pathname);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+// lookup time of numbers, which are mostly on no list, without and with the prefix filter
+static int benchFilter(size_t numEntries, size_t numLookups) {
+  char tmpl[] = "/tmp/callblocker-bench-XXXXXX";
+  if (mkdtemp(tmpl) == NULL) {
+    fprintf(stderr, "creating temporary directory failed\n");
+    return 1;
+  }
+  std::string pathname = tmpl;
+  std::mt19937 random(42);
+  if (!writeList(pathname + "/list.json", numEntries, &random)) {
+    fprintf(stderr, "writing list failed\n");
+    removeDirectory(pathname);
+    return 1;
+  }
+  std::vector<std::string> numbers;
+  for(size_t i = 0; i < numLookups; i++) {
+    numbers.push_back(randomNumber(&random));
+  }
+
+  double rates[] = {0, 0.1, 0.01, 0.001};
+  for(size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+    FileLists* lists = new FileLists(pathname, rates[r]);
+    std::string listName, callerName;
+    size_t found = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < numbers.size(); i++) {
+      if (lists->isListed(numbers[i], &listName, &callerName)) found++;
+    }
+    double ms = elapsedMs(start);
+    struct FileListsFilterStats stats;
+    lists->getFilterStats(&stats);
+    printf("{\"bench\": \"filter\", \"fp_rate\": %g, \"entries\": %zu, \"lookups\": %zu, \"found\": %zu, \"ns_per_lookup\": %.0f, "
+      "\"rejected\": %llu, \"passed\": %llu, \"false_positives\": %llu}\n",
+      rates[r], numEntries, numbers.size(), found, ms * 1000000.0 / numbers.size(),
+      (unsigned long long)stats.rejected, (unsigned long long)stats.passed, (unsigned long long)stats.falsePositives);
+    delete lists;
+  }
+
+  removeDirectory(pathname);
+  return 0;
+}
+
+// lookups in the trie alone, without the locking and copying of FileLists
+static int benchTrie(size_t numKeys, size_t numLookups) {
+  std::mt19937 random(42);
+  std::vector<std::string> keys;
+  for(size_t i = 0; i < numKeys; i++) {
+    keys.push_back(randomNumber(&random));
+  }
+  std::vector<const char*> pKeys;
+  std::vector<uint32_t> values;
+  for(size_t i = 0; i < keys.size(); i++) {
+    pKeys.push_back(keys[i].c_str());
+    values.push_back(i);
+  }
+  NumberTrie trie;
+  trie.build(pKeys, values);
+
+  // a quarter of the lookups are listed numbers
+  std::vector<std::string> numbers;
+  for(size_t i = 0; i < numLookups; i++) {
+    numbers.push_back(i % 4 == 0 ? keys[random() % keys.size()] + "12" : randomNumber(&random));
+  }
+  size_t found = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < numbers.size(); i++) {
+    uint32_t value;
+    if (trie.find(numbers[i], &value)) found++;
+  }
+  double ms = elapsedMs(start);
+  printf("{\"bench\": \"trie\", \"keys\": %zu, \"lookups\": %zu, \"found\": %zu, \"ns_per_lookup\": %.1f}\n",
+    numKeys, numbers.size(), found, ms * 1000000.0 / numbers.size());
+  return 0;
+}
+
+// prefix compare of a caller number with a list entry, as string and packed,
+// few enough pairs to stay in the cache like the hot nodes of the trie
+static int benchPrefix(size_t numPairs, size_t rounds) {
+  std::mt19937 random(42);
+  std::vector<std::string> numbers, prefixes;
+  std::vector<PackedNumber> packedNumbers, packedPrefixes;
+  for(size_t i = 0; i < numPairs; i++) {
+    std::string number = randomNumber(&random);
+    // half of the pairs match
+    std::string prefix = i % 2 == 0 ? number.substr(0, 6 + random() % 5) : randomNumber(&random).substr(0, 6 + random() % 5);
+    numbers.push_back(number);
+    prefixes.push_back(prefix);
+    packedNumbers.push_back(PackedNumber(number));
+    packedPrefixes.push_back(PackedNumber(prefix));
+  }
+
+  size_t found = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(size_t r = 0; r < rounds; r++) {
+    for(size_t i = 0; i < numPairs; i++) {
+      if (strncmp(numbers[i].c_str(), prefixes[i].c_str(), prefixes[i].length()) == 0) found++;
+    }
+  }
+  double msString = elapsedMs(start);
+  size_t foundPacked = 0;
+  start = std::chrono::steady_clock::now();
+  for(size_t r = 0; r < rounds; r++) {
+    for(size_t i = 0; i < numPairs; i++) {
+      if (packedNumbers[i].startsWith(packedPrefixes[i])) foundPacked++;
+    }
+  }
+  double msPacked = elapsedMs(start);
+  if (found != foundPacked) {
+    fprintf(stderr, "packed compare found %zu, string compare %zu\n", foundPacked, found);
+    return 1;
+  }
+  double n = (double)numPairs * rounds;
+  printf("{\"bench\": \"prefix\", \"compares\": %.0f, \"found\": %zu, \"ns_string\": %.2f, \"ns_packed\": %.2f}\n",
+    n, found, msString * 1000000.0 / n, msPacked * 1000000.0 / n);
+  return 0;
+}
+
+#define BENCH_ENTRIES_PER_FILE  1000000
+
+// writes numEntries entries into files of at most BENCH_ENTRIES_PER_FILE entries
+// pNumbers: gets a sample of the written numbers
+static bool writeLists(const std::string& rPathname, size_t numEntries, std::mt19937* pRandom, std::vector<std::string>* pNumbers) {
+  if (mkdir(rPathname.c_str(), 0755) != 0) {
+    return false;
+  }
+  for(size_t i = 0; i * BENCH_ENTRIES_PER_FILE < numEntries; i++) {
+    char filename[32];
+    snprintf(filename, sizeof(filename), "/list%03zu.json", i);
+    // the state of the generator before the file, to take a sample of its numbers
+    std::mt19937 before = *pRandom;
+    size_t num = std::min(numEntries - i * BENCH_ENTRIES_PER_FILE, (size_t)BENCH_ENTRIES_PER_FILE);
+    if (!writeList(rPathname + filename, num, pRandom)) {
+      return false;
+    }
+    for(size_t j = 0; j < num && j < 10000; j++) {
+      pNumbers->push_back(randomNumber(&before));
+      (void)randomName(&before);
+    }
+  }
+  return true;
+}
+
+static void printPercentiles(std::vector<double>* pNs) {
+  std::sort(pNs->begin(), pNs->end());
+  double percentiles[] = {50, 90, 99, 99.9};
+  const char* names[] = {"p50", "p90", "p99", "p999"};
+  for(size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+    size_t pos = std::min((size_t)(percentiles[i] / 100 * pNs->size()), pNs->size() - 1);
+    printf(", \"%s_ns\": %.0f", names[i], (*pNs)[pos]);
+  }
+  printf(", \"max_ns\": %.0f", pNs->back());
+}
+
+// the decision path as a phone uses it, for each block mode: load time and memory
+// of the lists, latency percentiles of FileLists::isListed and Block::isNumberBlocked
+// The whitelists get a tenth of the entries of the blacklists.
+static int benchBlock(size_t numEntries, size_t numLookups) {
+  char tmpl[] = "/tmp/callblocker-bench-XXXXXX";
+  if (mkdtemp(tmpl) == NULL) {
+    fprintf(stderr, "creating temporary directory failed\n");
+    return 1;
+  }
+  std::string pathname = tmpl;
+  std::string whitelists = pathname + "/whitelists";
+  std::string blacklists = pathname + "/blacklists";
+  size_t numWhitelisted = std::max(numEntries / 10, (size_t)1);
+  std::mt19937 random(42);
+  std::vector<std::string> whiteNumbers, blackNumbers;
+  if (!writeLists(whitelists, numWhitelisted, &random, &whiteNumbers) ||
+      !writeLists(blacklists, numEntries, &random, &blackNumbers)) {
+    fprintf(stderr, "writing lists failed\n");
+    removeDirectory(pathname);
+    return 1;
+  }
+
+  // a child process per list size, so the memory of the lists is measured alone
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    long before = getRssKb();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Block* block = new Block(NULL, whitelists, blacklists, 0);
+    double loadMs = elapsedMs(start);
+    long rss = getRssKb() - before;
+    delete block;
+    // again, with the index compiled by the first load
+    start = std::chrono::steady_clock::now();
+    block = new Block(NULL, whitelists, blacklists, 0);
+    double cachedLoadMs = elapsedMs(start);
+    long cachedRss = getRssKb() - before;
+    printf("{\"bench\": \"block_load\", \"entries\": %zu, \"whitelist_entries\": %zu, \"load_ms\": %.1f, \"rss_kb\": %ld, "
+      "\"cached_load_ms\": %.1f, \"cached_rss_kb\": %ld}\n",
+      numEntries, numWhitelisted, loadMs, rss, cachedLoadMs, cachedRss);
+
+    // calls: 20% from blacklisted, 5% from whitelisted numbers, the others are on no list
+    std::vector<std::string> numbers;
+    for(size_t i = 0; i < numLookups; i++) {
+      unsigned int r = random() % 100;
+      if (r < 20) numbers.push_back(blackNumbers[random() % blackNumbers.size()]);
+      else if (r < 25) numbers.push_back(whiteNumbers[random() % whiteNumbers.size()]);
+      else numbers.push_back(randomNumber(&random));
+    }
+    std::vector<double> ns(numbers.size());
+
+    FileLists* lists[] = {new FileLists(whitelists), new FileLists(blacklists)};
+    const char* listNames[] = {"whitelists", "blacklists"};
+    for(size_t l = 0; l < 2; l++) {
+      std::string listName, callerName;
+      size_t found = 0;
+      for(size_t i = 0; i < numbers.size(); i++) {
+        std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+        if (lists[l]->isListed(numbers[i], &listName, &callerName)) found++;
+        ns[i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t).count();
+      }
+      printf("{\"bench\": \"block_lookup\", \"entries\": %zu, \"api\": \"FileLists::isListed\", \"lists\": \"%s\", "
+        "\"lookups\": %zu, \"found\": %zu", numEntries, listNames[l], numbers.size(), found);
+      printPercentiles(&ns);
+      printf("}\n");
+      delete lists[l];
+    }
+
+    enum SettingBlockMode modes[] = {LOGGING_ONLY, WHITELISTS_ONLY, WHITELISTS_AND_BLACKLISTS, BLACKLISTS_ONLY};
+    const char* modeNames[] = {"logging_only", "whitelists_only", "whitelists_and_blacklists", "blacklists_only"};
+    for(size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+      struct SettingBase settings;
+      settings.name = "bench";
+      settings.countryCode = "+41";
+      settings.blockMode = modes[m];
+      settings.blockAnonymousCID = false;
+      size_t blocked = 0;
+      for(size_t i = 0; i < numbers.size(); i++) {
+        std::string msg;
+        std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+        if (block->isNumberBlocked(&settings, numbers[i], NULL, &msg)) blocked++;
+        ns[i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t).count();
+      }
+      printf("{\"bench\": \"block_lookup\", \"entries\": %zu, \"api\": \"Block::isNumberBlocked\", \"block_mode\": \"%s\", "
+        "\"lookups\": %zu, \"blocked\": %zu", numEntries, modeNames[m], numbers.size(), blocked);
+      printPercentiles(&ns);
+      printf("}\n");
+    }
+    delete block;
+    fflush(stdout);
+    _exit(0);
+  }
+  int status = 1;
+  if (pid < 0 || waitpid(pid, &status, 0) != pid) {
+    fprintf(stderr, "running block child failed\n");
+  }
+  removeDirectory(pathname);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+// self-check of the index: each lookup is compared with a naive scan of the loaded
+// lists, where the first matching entry of the first list wins
+#define VERIFY_LISTS            4
+#define VERIFY_MAX_MISMATCHES   10  // printed
+#define VERIFY_EXPIRY_SEC       2   // after the index was built, entries of the expiry case expire
+
+static bool isNaiveWildcard(char c) {
+  return c == 'x' || c == 'X' || c == '?';
+}
+
+static bool isNaiveDigits(const std::string& rStr) {
+  return rStr.find_first_not_of("0123456789") == std::string::npos;
+}
+
+// "[+]from-[+]to" with ends of the same length, or "[+]from-to", where to replaces the last digits of from
+// pFrom, pTo: the ends as values, pDigits: the number of digits compared
+static bool naiveRange(const char* pEntry, bool* pPlus, unsigned long long* pFrom, unsigned long long* pTo, size_t* pDigits) {
+  std::string entry = pEntry;
+  size_t dash = entry.find('-');
+  if (dash == std::string::npos) {
+    return false;
+  }
+  std::string from = entry.substr(0, dash);
+  std::string to = entry.substr(dash + 1);
+  *pPlus = !from.empty() && from[0] == '+';
+  if (*pPlus) from.erase(0, 1);
+  bool full = !to.empty() && to[0] == '+';
+  if (full) to.erase(0, 1);
+  if (from.empty() || from.length() > 18 || !isNaiveDigits(from) || !isNaiveDigits(to) ||
+      (full && (!*pPlus || to.length() != from.length())) || to.length() > from.length()) {
+    return false;
+  }
+  unsigned long long scale = 1;
+  for(size_t i = 0; i < to.length(); i++) scale *= 10;
+  *pFrom = strtoull(from.c_str(), NULL, 10);
+  *pTo = *pFrom - *pFrom % scale + strtoull(to.c_str(), NULL, 10);
+  *pDigits = from.length();
+  return *pFrom <= *pTo;
+}
+
+// a wildcard matches any digit, a range the numbers starting with a value between its ends,
+// anything else is a literal prefix
+static bool naiveMatches(const char* pEntry, const std::string& rNumber) {
+  bool plus;
+  unsigned long long from, to;
+  size_t digits;
+  if (naiveRange(pEntry, &plus, &from, &to, &digits)) {
+    size_t start = plus ? 1 : 0;
+    if (rNumber.length() < start + digits || (plus && rNumber[0] != '+')) {
+      return false;
+    }
+    std::string value = rNumber.substr(start, digits);
+    if (!isNaiveDigits(value)) {
+      return false;
+    }
+    unsigned long long v = strtoull(value.c_str(), NULL, 10);
+    return v >= from && v <= to;
+  }
+
+  size_t len = strlen(pEntry);
+  bool wildcard = false;
+  bool literal = false;
+  for(size_t i = 0; i < len; i++) {
+    if (isNaiveWildcard(pEntry[i])) wildcard = true;
+    else if (!(pEntry[i] >= '0' && pEntry[i] <= '9') && !(pEntry[i] == '+' && i == 0)) literal = true;
+  }
+  if (!wildcard || literal) {
+    return strncmp(pEntry, rNumber.c_str(), len) == 0;
+  }
+  if (rNumber.length() < len) {
+    return false;
+  }
+  for(size_t i = 0; i < len; i++) {
+    if (isNaiveWildcard(pEntry[i]) ? !(rNumber[i] >= '0' && rNumber[i] <= '9') : pEntry[i] != rNumber[i]) return false;
+  }
+  return true;
+}
+
+static bool naiveIsListed(const std::vector<FileList*>& rLists, const std::string& rNumber, int64_t now,
+                          std::string* pListName, std::string* pCallerName) {
+  for(size_t i = 0; i < rLists.size(); i++) {
+    for(size_t j = 0; j < rLists[i]->getNumEntries(); j++) {
+      if (FileList::isExpired(rLists[i]->getExpires(j), now)) continue;
+      if (naiveMatches(rLists[i]->getNumber(j), rNumber)) {
+        *pListName = rLists[i]->getName();
+        *pCallerName = rLists[i]->getEntryName(j);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+static std::string verifyPrefix(std::mt19937* pRandom) {
+  static const char* s_prefixes[] = {"+4144", "+4179", "+4930", "044"};
+  return s_prefixes[(*pRandom)() % (sizeof(s_prefixes) / sizeof(s_prefixes[0]))];
+}
+
+static std::string verifyDigits(std::mt19937* pRandom, size_t num) {
+  std::string digits;
+  for(size_t i = 0; i < num; i++) {
+    digits.push_back('0' + (*pRandom)() % 10);
+  }
+  return digits;
+}
+
+// short numbers under few prefixes, so entries are prefixes of each other and
+// the same number is on several lists, maxDigits: at least 3
+static std::string verifyNumber(std::mt19937* pRandom, size_t maxDigits) {
+  return verifyPrefix(pRandom) + verifyDigits(pRandom, 3 + (*pRandom)() % (maxDigits - 2));
+}
+
+// rDigits with value added, empty when it does not fit into their length
+static std::string addToDigits(const std::string& rDigits, int value) {
+  long long v = strtoll(rDigits.c_str(), NULL, 10) + value;
+  std::string res = std::to_string(v);
+  if (v < 0 || res.length() > rDigits.length()) {
+    return "";
+  }
+  return std::string(rDigits.length() - res.length(), '0') + res;
+}
+
+// pSamples: gets numbers at the edges of the entry, which may or may not match
+static std::string verifyEntry(std::mt19937* pRandom, bool patterns, std::vector<std::string>* pSamples) {
+  unsigned int kind = patterns ? (*pRandom)() % 10 : 0;
+  std::string prefix = verifyPrefix(pRandom);
+  std::string number;
+  if (kind <= 3) {
+    number = verifyNumber(pRandom, 5);
+    pSamples->push_back(number);
+    if ((*pRandom)() % 50 == 0) {
+      // not indexable, only found by the scan of the unindexed entries
+      number.insert(3 + (*pRandom)() % (number.length() - 3), " ");
+      pSamples->push_back(number);
+    }
+  } else if (kind <= 6) {
+    // wildcards within the number and at its end
+    number = prefix + verifyDigits(pRandom, 4 + (*pRandom)() % 3);
+    for(size_t i = prefix.length(); i < number.length(); i++) {
+      if ((*pRandom)() % 4 == 0) number[i] = "xX?"[(*pRandom)() % 3];
+    }
+    if ((*pRandom)() % 2 == 0) number += std::string(1 + (*pRandom)() % 3, 'x');
+    std::string sample = number;
+    for(size_t i = 0; i < sample.length(); i++) {
+      if (isNaiveWildcard(sample[i])) sample[i] = '0' + (*pRandom)() % 10;
+    }
+    pSamples->push_back(sample);
+    pSamples->push_back(sample.substr(0, sample.length() - 1));
+  } else {
+    // ranges sharing the first digits of their ends, so they overlap each other
+    size_t len = 5 + (*pRandom)() % 2;
+    size_t same = len - 1 - (*pRandom)() % 3;
+    std::string from = verifyDigits(pRandom, len);
+    std::string to = from.substr(0, same) + verifyDigits(pRandom, len - same);
+    if (to < from) from.swap(to);
+    if (kind <= 8) {
+      number = prefix + from + "-" + prefix + to;
+    } else {
+      // the short form
+      number = prefix + from + "-" + to.substr(same);
+    }
+    std::string edges[] = {from, to, addToDigits(from, -1), addToDigits(to, 1),
+                           addToDigits(from, (*pRandom)() % (strtoll(to.c_str(), NULL, 10) - strtoll(from.c_str(), NULL, 10) + 1))};
+    for(size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+      if (!edges[i].empty()) pSamples->push_back(prefix + edges[i]);
+    }
+  }
+  return number;
+}
+
+// samples of the entries with some more digits, and random numbers
+static std::string verifyLookup(const std::vector<std::string>& rSamples, std::mt19937* pRandom) {
+  std::string number;
+  if ((*pRandom)() % 2 == 0) {
+    number = rSamples[(*pRandom)() % rSamples.size()];
+  } else {
+    number = verifyNumber(pRandom, 5);
+  }
+  return number + verifyDigits(pRandom, (*pRandom)() % 5);
+}
+
+// rDates: date_created of each entry, 0 for none; the entries expire a day after it
+static bool writeVerifyList(const std::string& rFilename, const std::string& rName, const std::vector<std::string>& rEntries,
+                            const std::vector<int64_t>& rDates) {
+  FILE* f = fopen(rFilename.c_str(), "w");
+  if (f == NULL) {
+    return false;
+  }
+  fprintf(f, "{\n  \"name\": \"%s\",\n  \"max_age_days\": 1,\n  \"entries\": [\n", rName.c_str());
+  for(size_t i = 0; i < rEntries.size(); i++) {
+    char date[64] = "";
+    if (rDates[i] != 0) {
+      time_t t = rDates[i];
+      struct tm tm;
+      strftime(date, sizeof(date), ", \"date_created\": \"%Y-%m-%d %H:%M:%S +0000\"", gmtime_r(&t, &tm));
+    }
+    fprintf(f, "    {\"number\": \"%s\", \"name\": \"%s entry %zu\"%s}%s\n",
+      rEntries[i].c_str(), rName.c_str(), i, date, i + 1 < rEntries.size() ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+  return fclose(f) == 0;
+}
+
+// returns the number of lookups, where the index and the naive scan differ
+static size_t verifyLookups(const char* pCase, const std::vector<FileList*>& rLists, const ListIndex& rIndex,
+                            const std::vector<std::string>& rNumbers) {
+  size_t found = 0;
+  size_t mismatches = 0;
+  for(size_t i = 0; i < rNumbers.size(); i++) {
+    std::string listName, callerName, naiveListName, naiveCallerName;
+    bool listed;
+    int64_t now;
+    do {
+      // the index takes the time on its own, the scan has to use the same second
+      now = time(NULL);
+      listed = rIndex.isListed(rNumbers[i], &listName, &callerName);
+    } while (time(NULL) != now);
+    bool naiveListed = naiveIsListed(rLists, rNumbers[i], now, &naiveListName, &naiveCallerName);
+    if (naiveListed) found++;
+    if (listed != naiveListed || (listed && (listName != naiveListName || callerName != naiveCallerName))) {
+      if (mismatches < VERIFY_MAX_MISMATCHES) {
+        fprintf(stderr, "%s: '%s' found as '%s' in '%s', expected '%s' in '%s'\n", pCase, rNumbers[i].c_str(),
+          listed ? callerName.c_str() : "-", listed ? listName.c_str() : "-",
+          naiveListed ? naiveCallerName.c_str() : "-", naiveListed ? naiveListName.c_str() : "-");
+      }
+      mismatches++;
+    }
+  }
+  printf("{\"bench\": \"verify\", \"case\": \"%s\", \"lookups\": %zu, \"found\": %zu, \"mismatches\": %zu}\n",
+    pCase, rNumbers.size(), found, mismatches);
+  return mismatches;
+}
+
+// expiry: a quarter of the entries of every other list expire VERIFY_EXPIRY_SEC after the index
+// was built, the lookups are done before and after
+// pMismatches: incremented by the lookups, where the index and the naive scan differ
+static bool verifyCase(const char* pCase, const std::string& rPathname, bool patterns, bool expiry, size_t entriesPerList,
+                       size_t numLookups, std::mt19937* pRandom, size_t* pMismatches) {
+  std::string pathname = rPathname + "/" + pCase;
+  if (mkdir(pathname.c_str(), 0755) != 0) {
+    fprintf(stderr, "creating %s failed\n", pathname.c_str());
+    return false;
+  }
+  int64_t expires = time(NULL) + VERIFY_EXPIRY_SEC;
+  std::vector<std::string> samples;
+  std::vector<FileList*> lists;
+  bool ok = true;
+  for(size_t i = 0; i < VERIFY_LISTS && ok; i++) {
+    std::vector<std::string> entries;
+    std::vector<int64_t> dates;
+    if (expiry) {
+      // the first entry of the first list expires, the same number is found by a shorter one of the second
+      entries.push_back(i == 0 ? "+41449990" : "+4144999");
+      dates.push_back(i == 0 ? expires - 24 * 60 * 60 : 0);
+    }
+    for(size_t j = 0; j < entriesPerList; j++) {
+      entries.push_back(verifyEntry(pRandom, patterns, &samples));
+      // expiring, not loaded as already expired, expiring tomorrow, never expiring
+      int64_t date[] = {expires - 24 * 60 * 60, expires - 3 * 24 * 60 * 60, expires, 0};
+      dates.push_back(expiry && i % 2 == 0 ? date[(*pRandom)() % 4] : 0);
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "list%zu", i);
+    FileList* l = new FileList();
+    lists.push_back(l);
+    ok = writeVerifyList(pathname + "/" + name + ".json", name, entries, dates) && l->load(pathname + "/" + name + ".json");
+  }
+  if (!ok) {
+    fprintf(stderr, "writing lists failed\n");
+  }
+
+  if (ok) {
+    std::string data;
+    ListIndex::create(lists, &data);
+    ListIndex index;
+    ok = index.attach(&data);
+    if (ok && expiry && time(NULL) >= expires) {
+      fprintf(stderr, "%s: entries expired before the index was built\n", pCase);
+      ok = false;
+    }
+    std::vector<std::string> numbers;
+    if (expiry) numbers.push_back("+41449990123"); // first, before its entry expires
+    for(size_t i = 0; i < numLookups; i++) {
+      numbers.push_back(verifyLookup(samples, pRandom));
+    }
+    if (ok) *pMismatches += verifyLookups(pCase, lists, index, numbers);
+    if (ok && expiry) {
+      while (time(NULL) < expires) {
+        usleep(100 * 1000);
+      }
+      *pMismatches += verifyLookups("expired", lists, index, numbers);
+    }
+  }
+
+  for(size_t i = 0; i < lists.size(); i++) {
+    delete lists[i];
+  }
+  return ok;
+}
+
+// lookups of the index compared with a naive scan of the lists, fails on any difference
+static int benchVerify(size_t entriesPerList, size_t numLookups) {
+  char tmpl[] = "/tmp/callblocker-bench-XXXXXX";
+  if (mkdtemp(tmpl) == NULL) {
+    fprintf(stderr, "creating temporary directory failed\n");
+    return 1;
+  }
+  std::string pathname = tmpl;
+  std::mt19937 random(42);
+  size_t mismatches = 0;
+  bool ok = verifyCase("plain", pathname, false, false, entriesPerList, numLookups, &random, &mismatches) &&
+            verifyCase("patterns", pathname, true, false, entriesPerList, numLookups, &random, &mismatches) &&
+            verifyCase("expiry", pathname, true, true, entriesPerList, numLookups, &random, &mismatches);
+  removeDirectory(pathname);
+  return ok && mismatches == 0 ? 0 : 1;
+}
+
+static void usage(const char* pName) {
+  fprintf(stderr, "usage: %s load [files] [entries per file]\n", pName);
+  fprintf(stderr, "       %s parse [entries]\n", pName);
+  fprintf(stderr, "       %s memory [entries]\n", pName);
+  fprintf(stderr, "       %s filter [entries] [lookups]\n", pName);
+  fprintf(stderr, "       %s trie [keys] [lookups]\n", pName);
+  fprintf(stderr, "       %s prefix [pairs] [rounds]\n", pName);
+  fprintf(stderr, "       %s block [entries[,entries...]] [lookups]\n", pName);
+  fprintf(stderr, "       %s verify [entries per list] [lookups]\n", pName);
+}
+
+int main(int argc, char *argv[]) {
+  Logger::setLogLevel("warn");
+
+  if (argc < 2) {
+    usage(argv[0]);
+    return 1;
+  }
+  std::string bench = argv[1];
+  if (bench == "load") {
+    size_t numFiles = argc > 2 ? strtoul(argv[2], NULL, 10) : 16;
+    size_t entriesPerFile = argc > 3 ? strtoul(argv[3], NULL, 10) : 50000;
+    return benchLoad(numFiles, entriesPerFile);
+  }
+  if (bench == "parse") {
+    size_t numEntries = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000;
+    return benchParse(numEntries);
+  }
+  if (bench == "memory") {
+    size_t numEntries = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000;
+    return benchMemory(numEntries);
+  }
+  if (bench == "filter") {
+    size_t numEntries = argc > 2 ? strtoul(argv[2], NULL, 10) : 200000;
+    size_t numLookups = argc > 3 ? strtoul(argv[3], NULL, 10) : 1000000;
+    return benchFilter(numEntries, numLookups);
+  }
+  if (bench == "trie") {
+    size_t numKeys = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000;
+    size_t numLookups = argc > 3 ? strtoul(argv[3], NULL, 10) : 4000000;
+    return benchTrie(numKeys, numLookups);
+  }
+  if (bench == "prefix") {
+    size_t numPairs = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000;
+    size_t rounds = argc > 3 ? strtoul(argv[3], NULL, 10) : 10000;
+    return benchPrefix(numPairs, rounds);
+  }
+  if (bench == "block") {
+    std::string sizes = argc > 2 ? argv[2] : "1000,10000,100000,1000000,10000000";
+    size_t numLookups = argc > 3 ? strtoul(argv[3], NULL, 10) : 200000;
+    const char* p = sizes.c_str();
+    while (*p != '\0') {
+      char* end;
+      size_t numEntries = strtoul(p, &end, 10);
+      if (end == p || numEntries == 0 || benchBlock(numEntries, numLookups) != 0) {
+        return 1;
+      }
+      p = *end == ',' ? end + 1 : end;
+    }
+    return 0;
+  }
+  if (bench == "verify") {
+    size_t entriesPerList = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000;
+    size_t numLookups = argc > 3 ? strtoul(argv[3], NULL, 10) : 10000;
+    return benchVerify(entriesPerList, numLookups);
+  }
+  usage(argv[0]);
+  return 1;
+}
+
@@ -19,6 +19,9 @@
 
 #include "Block.h" // API
 
+#include <thread>
+#include <algorithm>
+#include <unistd.h>
 #include <json-c/json.h>
 #include <boost/algorithm/string/predicate.hpp>
 
@@ -26,29 +29,180 @@
 #include "Helper.h"
 
 
+#define STOP_POLL_MS  100  // how fast a waiting call notices that it was stopped
+
+
 Block::Block(Settings* pSettings) {
   Logger::debug("Block::Block()...");
   m_pSettings = pSettings;
+  m_pending = 0;
+  m_onlineStarted = 0;
+  m_onlineCoalesced = 0;
+  init(SYSCONFDIR "/" PACKAGE_NAME "/configs/whitelists", SYSCONFDIR "/" PACKAGE_NAME "/configs/blacklists",
+       m_pSettings->getListFilterFpRate());
+  m_pOnlineCache = new OnlineCache(SYSCONFDIR "/" PACKAGE_NAME "/configs/.cache/online.cache");
+  reloadSettings();
+  startWorkers();
+}
+
+// lists of other directories, used by the benchmarks
+// pSettings: only needed for the credentials of online checks and lookups, may be NULL without them
+Block::Block(Settings* pSettings, const std::string& rWhitelistsDir, const std::string& rBlacklistsDir, double filterFpRate) {
+  Logger::debug("Block::Block()...");
+  m_pSettings = pSettings;
+  m_pending = 0;
+  m_onlineStarted = 0;
+  m_onlineCoalesced = 0;
+  init(rWhitelistsDir, rBlacklistsDir, filterFpRate);
+  m_pOnlineCache = NULL;
+  m_maxWorkers = 1;
+  m_scriptWorkers = false;
+  m_onlineDeadlineMs = 0;
+  m_onlineCachePositiveTtl = 0;
+  m_onlineCacheNegativeTtl = 0;
+  if (m_pSettings != NULL) reloadSettings();
+}
 
-  m_pWhitelists = new FileLists(SYSCONFDIR "/" PACKAGE_NAME "/configs/whitelists");
-  m_pBlacklists = new FileLists(SYSCONFDIR "/" PACKAGE_NAME "/configs/blacklists");
+void Block::init(const std::string& rWhitelistsDir, const std::string& rBlacklistsDir, double filterFpRate) {
+  m_pWhitelists = new FileLists(rWhitelistsDir, filterFpRate);
+  m_pBlacklists = new FileLists(rBlacklistsDir, filterFpRate);
 }
 
 Block::~Block() {
   Logger::debug("Block::~Block()...");
 
+  // online requests of timed out calls may still use the cache and the workers
+  {
+    std::unique_lock<std::mutex> lock(m_pendingMutex);
+    if (m_pending > 0) {
+      Logger::info("waiting for %d online requests", m_pending);
+    }
+    m_pendingCond.wait(lock, [this] { return m_pending == 0; });
+  }
+
   delete m_pWhitelists;
   m_pWhitelists = NULL;
   delete m_pBlacklists;
   m_pBlacklists = NULL;
+  delete m_pOnlineCache;
+  m_pOnlineCache = NULL;
+  for (std::map<std::string, std::vector<ScriptWorker*>>::iterator it = m_workers.begin(); it != m_workers.end(); ++it) {
+    for(size_t i = 0; i < it->second.size(); i++) {
+      delete it->second[i];
+    }
+  }
+  m_workers.clear();
+  for (std::map<std::string, OnlinePlugin*>::iterator it = m_plugins.begin(); it != m_plugins.end(); ++it) {
+    delete it->second;
+  }
+  m_plugins.clear();
+}
+
+// has to be called by the main loop, when the settings have changed
+void Block::reloadSettings() {
+  m_scriptWorkers = m_pSettings->getScriptWorkers();
+  m_onlineDeadlineMs = m_pSettings->getOnlineDeadlineMs();
+  m_onlineCachePositiveTtl = m_pSettings->getOnlineCachePositiveTtl();
+  m_onlineCacheNegativeTtl = m_pSettings->getOnlineCacheNegativeTtl();
+  m_circuitBreaker.setMaxFailures(m_pSettings->getOnlineBreakerFailures());
+}
+
+// the scripts of all phones are started ahead, so even the first call does not wait for them
+void Block::startWorkers() {
+  std::vector<struct SettingBase> phones;
+  std::vector<struct SettingSipAccount> accounts = m_pSettings->getSipAccounts();
+  for(size_t i = 0; i < accounts.size(); i++) phones.push_back(accounts[i].base);
+  std::vector<struct SettingAnalogPhone> analogPhones = m_pSettings->getAnalogPhones();
+  for(size_t i = 0; i < analogPhones.size(); i++) phones.push_back(analogPhones[i].base);
+
+  // each analog phone decides one call at a time, all SIP accounts together sip_max_calls
+  m_maxWorkers = analogPhones.size() + (accounts.empty() ? 0 : m_pSettings->getSipMaxCalls());
+  if (m_maxWorkers == 0) m_maxWorkers = 1;
+  if (!m_scriptWorkers) {
+    return;
+  }
+
+  for(size_t i = 0; i < phones.size(); i++) {
+    const struct SettingOnlineScript* scripts[] = {phones[i].onlineCheckScript.get(), phones[i].onlineLookupScript.get()};
+    for(size_t j = 0; j < 2; j++) {
+      if (scripts[j] != NULL && getPlugin(scripts[j]->name) == NULL) {
+        (void)getWorker(scripts[j]->script, 0)->start();
+      }
+    }
+    if (phones[i].blockAnonymousCID) {
+      (void)getWorker(SCRIPTS_DIR "anonymous.py", 0)->start();
+    }
+  }
+}
+
+// the workers of a script are created when needed, NULL if index exceeds their maximum
+ScriptWorker* Block::getWorker(const std::string& rScript, size_t index) {
+  std::lock_guard<std::mutex> lock(m_workersMutex);
+  std::vector<ScriptWorker*>& workers = m_workers[rScript];
+  if (index < workers.size()) {
+    return workers[index];
+  }
+  if (index >= m_maxWorkers) {
+    return NULL;
+  }
+  ScriptWorker* worker = new ScriptWorker(rScript);
+  workers.push_back(worker);
+  return workers.back();
+}
+
+// a plugin replaces the script of the same name, e.g. onlinecheck_<name>.so instead of onlinecheck_<name>.py
+OnlinePlugin* Block::getPlugin(const std::string& rScriptName) {
+  std::lock_guard<std::mutex> lock(m_workersMutex);
+  std::map<std::string, OnlinePlugin*>::iterator it = m_plugins.find(rScriptName);
+  if (it != m_plugins.end()) {
+    return it->second;
+  }
+  OnlinePlugin* plugin = NULL;
+  std::string filename = PLUGINS_DIR + rScriptName + ".so";
+  if (access(filename.c_str(), F_OK) == 0) {
+    plugin = new OnlinePlugin(filename);
+    if (!plugin->load()) {
+      delete plugin;
+      plugin = NULL; // error already logged, the script is used
+    }
+  }
+  m_plugins[rScriptName] = plugin;
+  return plugin;
+}
+
+// runs the script by its worker, one-shot when there is no worker
+bool Block::executeScript(const std::string& rScript, const std::vector<const char*>& rArgs, std::string* pRes) {
+  if (m_scriptWorkers) {
+    // the first idle worker, a request never waits for another one to finish
+    ScriptWorker* worker;
+    for(size_t i = 0; (worker = getWorker(rScript, i)) != NULL; i++) {
+      enum ScriptWorkerResult ret = worker->execute(rArgs, pRes);
+      if (ret == SCRIPTWORKER_BUSY) continue;
+      if (ret != SCRIPTWORKER_UNAVAILABLE) {
+        return ret == SCRIPTWORKER_OK;
+      }
+      break;
+    }
+  }
+  return Helper::executeProgram(rScript, rArgs, SCRIPTWORKER_TIMEOUT_MS, pRes);
+}
+
+// run() has to be called, when one of these is readable
+std::vector<int> Block::getFDs() {
+  std::vector<int> res;
+  res.push_back(m_pWhitelists->getFD());
+  res.push_back(m_pBlacklists->getFD());
+  return res;
 }
 
 void Block::run() {
   m_pWhitelists->run();
   m_pBlacklists->run();
+  if (m_pOnlineCache != NULL) m_pOnlineCache->run();
 }
 
-bool Block::isAnonymousNumberBlocked(const struct SettingBase* pSettings, std::string* pMsg) {
+bool Block::isAnonymousNumberBlocked(const struct SettingBase* pSettings, const std::atomic<bool>* pStop,
+                                     std::string* pMsg) {
   bool blockenabled = pSettings->blockAnonymousCID;
   bool block = false;
   
@@ -56,18 +210,29 @@ bool Block::isAnonymousNumberBlocked(const struct SettingBase* pSettings, std::s
   std::ostringstream oss;
   oss << "Incoming call: number='anonymous'";
   if (blockenabled) {
-    std::string script = "/usr/callblocker/scripts/anonymous.py";
-    std::string parameters = "--number anonymous";
-  
-    std::string res;
-    if (!Helper::executeCommand(script + " " + parameters + " 2>&1", &res)) {
-      return blockenabled; // script failed, error already logged
+    // in its own thread like the online scripts, so a stopped call does not wait for it
+    std::shared_ptr<struct OnlineRequest> request = std::make_shared<struct OnlineRequest>();
+    request->done = false;
+    request->ok = false;
+    {
+      std::lock_guard<std::mutex> lock(m_pendingMutex);
+      m_pending++;
     }
-    
+    std::thread(&Block::runAnonymous, this, request).detach();
+
+    // the script itself is bounded by SCRIPTWORKER_TIMEOUT_MS
+    if (!waitRequest(request, std::chrono::steady_clock::time_point::max(), pStop) || !request->ok) {
+      *pMsg = oss.str();
+      return blockenabled; // stopped or script failed, error already logged
+    }
+
     struct json_object* root;
-	root = json_tokener_parse(res.c_str());
+	root = json_tokener_parse(request->res.c_str());
 	
-    if (!Helper::getObject(root, "block", true, "script result", &block)) {
+    bool ok = Helper::getObject(root, "block", true, "script result", &block);
+    if (root != NULL) json_object_put(root);
+    if (!ok) {
+      *pMsg = oss.str();
       return blockenabled;
     }
   }
@@ -81,7 +246,8 @@ bool Block::isAnonymousNumberBlocked(const struct SettingBase* pSettings, std::s
   return block;
 }
 
-bool Block::isNumberBlocked(const struct SettingBase* pSettings, const std::string& rNumber, std::string* pMsg) {
+bool Block::isNumberBlocked(const struct SettingBase* pSettings, const std::string& rNumber, const std::atomic<bool>* pStop,
+                            std::string* pMsg) {
   Logger::debug("Block::isNumberBlocked(%s,number=%s)", pSettings->toString().c_str(), rNumber.c_str());
 
   std::string listName = "";
@@ -91,6 +257,7 @@ bool Block::isNumberBlocked(const struct SettingBase* pSettings, const std::stri
   bool onBlacklist = false;
   bool block = false;
 
+  bool checkSpam = false; // blacklists consulted, but number not listed
   switch (pSettings->blockMode) {
     default:
       Logger::warn("invalid block mode %d", pSettings->blockMode);
@@ -99,10 +266,11 @@ bool Block::isNumberBlocked(const struct SettingBase* pSettings, const std::stri
         onWhitelist = true;
         break;
       }
-      if (isBlacklisted(pSettings, rNumber, &listName, &callerName, &score)) {
+      if (isBlacklisted(pSettings, rNumber, &listName, &callerName)) {
         onBlacklist = true;
         break;
       }
+      checkSpam = true;
       break;
 
     case WHITELISTS_ONLY:
@@ -118,29 +286,62 @@ bool Block::isNumberBlocked(const struct SettingBase* pSettings, const std::stri
         onWhitelist = true;
         break;
       }
-      if (isBlacklisted(pSettings, rNumber, &listName, &callerName, &score)) {
+      if (isBlacklisted(pSettings, rNumber, &listName, &callerName)) {
         onBlacklist = true;
         block = true;
         break;
       }
+      checkSpam = true;
       break;
 
     case BLACKLISTS_ONLY:
-      if (isBlacklisted(pSettings, rNumber, &listName, &callerName, &score)) {
+      if (isBlacklisted(pSettings, rNumber, &listName, &callerName)) {
         onBlacklist = true;
         block = true;
         break;
       }
+      checkSpam = true;
       break;
   }
 
-  if (!onWhitelist && !onBlacklist) {
-    // online lookup caller name
-    if (pSettings->onlineLookup.length() != 0) {
-      struct json_object* root;
-      if (checkOnline("onlinelookup_", pSettings->onlineLookup, rNumber, &root)) {
-        (void)Helper::getObject(root, "name", false, "script result", &callerName);
-      }
+  // online check if spam and online lookup caller name, at the same time and within a common deadline
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+    std::chrono::milliseconds(m_onlineDeadlineMs);
+  std::shared_ptr<struct OnlineRequest> check;
+  std::shared_ptr<struct OnlineRequest> lookup;
+  if (checkSpam && pSettings->onlineCheckScript) {
+    check = startOnline(pSettings->onlineCheckScript, rNumber);
+  }
+
+  // a check known at once, e.g. by the cache, tells if the lookup is needed at all
+  struct OnlineResult result;
+  bool spam = false;
+  bool checked = false;
+  if (check && waitRequest(check, std::chrono::steady_clock::now(), NULL)) {
+    checked = true;
+    spam = waitOnline(check, deadline, pStop, pSettings->onlineCheckScript->name, rNumber, true, &result) && result.spam;
+  }
+  if (!spam && !onWhitelist && !onBlacklist && pSettings->onlineLookupScript) {
+    lookup = startOnline(pSettings->onlineLookupScript, rNumber);
+  }
+  if (check && !checked) {
+    spam = waitOnline(check, deadline, pStop, pSettings->onlineCheckScript->name, rNumber, true, &result) && result.spam;
+  }
+
+  if (spam) {
+    onBlacklist = true;
+    if (pSettings->blockMode != LOGGING_ONLY) {
+      block = true;
+    }
+    listName = pSettings->onlineCheck;
+    callerName = result.name;
+    score = result.score;
+  }
+  if (lookup) {
+    if (spam) {
+      releaseOnline(lookup); // the call is decided, its caller name is not needed
+    } else if (waitOnline(lookup, deadline, pStop, pSettings->onlineLookupScript->name, rNumber, false, &result)) {
+      callerName = result.name;
     }
   }
 
@@ -173,60 +374,232 @@ bool Block::isWhiteListed(const struct SettingBase* pSettings, const std::string
 }
 
 bool Block::isBlacklisted(const struct SettingBase* pSettings, const std::string& rNumber,
-                          std::string* pListName, std::string* pCallerName, std::string* pScore) {
-  if (m_pBlacklists->isListed(rNumber, pListName, pCallerName)) {
-    return true;
+                          std::string* pListName, std::string* pCallerName) {
+  return m_pBlacklists->isListed(rNumber, pListName, pCallerName);
+}
+
+// a request already done, for results known without running the script
+static std::shared_ptr<struct OnlineRequest> getDoneRequest(bool ok, const std::string& rRes) {
+  std::shared_ptr<struct OnlineRequest> request = std::make_shared<struct OnlineRequest>();
+  request->done = true;
+  request->ok = ok;
+  request->res = rRes;
+  return request;
+}
+
+// starts the plugin or the script, the script in its own thread
+std::shared_ptr<struct OnlineRequest> Block::startOnline(const std::shared_ptr<const struct SettingOnlineScript>& rScript,
+                                                         const std::string& rNumber) {
+  if (boost::starts_with(rNumber, "**")) {
+    // it is an intern number, thus makes no sense to ask the world
+    return getDoneRequest(false, "");
   }
 
-  // online check if spam
-  if (pSettings->onlineCheck.length() != 0) {
-    struct json_object* root;
-    if (checkOnline("onlinecheck_", pSettings->onlineCheck, rNumber, &root)) {
-      bool spam;
-      if (!Helper::getObject(root, "spam", true, "script result", &spam)) {
-        return false;
-      }
-      if (spam) {
-        *pListName = pSettings->onlineCheck;
-        (void)Helper::getObject(root, "name", false, "script result", pCallerName);
-        int score;
-        if (Helper::getObject(root, "score", false, "script result", &score)) {
-          *pScore = std::to_string(score);
-        }
-        return true;
+  const std::string& scriptName = rScript->name;
+  std::string res;
+  if (m_pOnlineCache != NULL && m_pOnlineCache->get(scriptName, rNumber, &res)) {
+    return getDoneRequest(true, res);
+  }
+
+  // a failing script is not waited for, but probed in the background after a while
+  enum CircuitBreakerDecision decision = m_circuitBreaker.check(scriptName);
+  if (decision == CIRCUITBREAKER_SKIP) {
+    return getDoneRequest(false, "");
+  }
+
+  // a number ringing several phones at once is asked only once
+  std::string key = scriptName + " " + rNumber;
+  std::shared_ptr<struct OnlineRequest> request;
+  {
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    std::map<std::string, std::shared_ptr<struct OnlineRequest>>::iterator it = m_inflight.find(key);
+    if (it != m_inflight.end()) {
+      m_onlineCoalesced++;
+      it->second->waiters++;
+      Logger::info("%s for %s already running, coalesced (%llu started, %llu coalesced)", scriptName.c_str(),
+        rNumber.c_str(), (unsigned long long)m_onlineStarted, (unsigned long long)m_onlineCoalesced);
+      if (decision == CIRCUITBREAKER_PROBE) {
+        it->second->probe = true; // its result tells, if the script is back
+        return getDoneRequest(false, "");
       }
+      return it->second;
     }
+    request = std::make_shared<struct OnlineRequest>();
+    request->done = false;
+    request->ok = false;
+    request->key = key;
+    request->script = rScript;
+    request->number = rNumber;
+    request->start = std::chrono::steady_clock::now();
+    request->positiveTtl = m_onlineCachePositiveTtl;
+    request->negativeTtl = m_onlineCacheNegativeTtl;
+    request->deadlineMs = m_onlineDeadlineMs;
+    request->probe = decision == CIRCUITBREAKER_PROBE;
+    request->waiters = 1;
+    m_inflight[key] = request;
+    m_onlineStarted++;
+    m_pending++;
   }
 
-  // no spam
-  return false;
+  OnlinePlugin* plugin = getPlugin(scriptName);
+  if (plugin != NULL) {
+    if (!plugin->check(rNumber, rScript->credentials, [this, request](bool ok, const std::string& rRes) {
+          finishOnline(request, ok, rRes);
+        })) {
+      finishOnline(request, false, ""); // error already logged
+    }
+  } else {
+    std::thread(&Block::runOnline, this, request).detach();
+  }
+  if (decision == CIRCUITBREAKER_PROBE) {
+    return getDoneRequest(false, ""); // the call does not wait for the probe
+  }
+  return request;
 }
 
-bool Block::checkOnline(std::string prefix, std::string scriptBaseName, const std::string& rNumber, struct json_object** root) {
-  if (boost::starts_with(rNumber, "**")) {
-    // it is an intern number, thus makes no sense to ask the world
-    return false;
+// the call does not need the result, it is not cached unless another call waits for it
+void Block::releaseOnline(std::shared_ptr<struct OnlineRequest> request) {
+  std::lock_guard<std::mutex> lock(m_pendingMutex);
+  if (request->waiters > 0) {
+    request->waiters--;
   }
+}
 
-  std::string script = "/usr/callblocker/scripts/" + prefix + scriptBaseName + ".py";
-  std::string parameters = "--number " + rNumber;
-  std::vector<struct SettingOnlineCredential> creds = m_pSettings->getOnlineCredentials();
-  for(size_t i = 0; i < creds.size(); i++) {
-    struct SettingOnlineCredential* cred = &creds[i];
-    if (cred->name == scriptBaseName) {
-      for (std::map<std::string,std::string>::iterator it = cred->data.begin(); it != cred->data.end(); ++it) {
-        parameters += " --" + it->first + "=" + it->second;
-      }
-      break;
-    }
+void Block::runOnline(std::shared_ptr<struct OnlineRequest> request) {
+  // --number <number> --key=value...
+  std::vector<const char*> args;
+  args.reserve(2 + request->script->args.size());
+  args.push_back("--number");
+  args.push_back(request->number.c_str());
+  for(size_t i = 0; i < request->script->args.size(); i++) {
+    args.push_back(request->script->args[i].c_str());
   }
 
   std::string res;
-  if (!Helper::executeCommand(script + " " + parameters + " 2>&1", &res)) {
-    return false; // script failed, error already logged
+  bool ok = executeScript(request->script->script, args, &res); // if failed, error already logged
+  finishOnline(request, ok, res);
+}
+
+void Block::runAnonymous(std::shared_ptr<struct OnlineRequest> request) {
+  std::vector<const char*> args;
+  args.push_back("--number");
+  args.push_back("anonymous");
+  std::string res;
+  bool ok = executeScript(SCRIPTS_DIR "anonymous.py", args, &res); // if failed, error already logged
+
+  {
+    std::lock_guard<std::mutex> lock(request->mutex);
+    request->ok = ok;
+    request->res = res;
+    request->done = true;
+  }
+  request->cond.notify_all();
+
+  std::lock_guard<std::mutex> lock(m_pendingMutex);
+  m_pending--;
+  m_pendingCond.notify_all();
+}
+
+void Block::finishOnline(std::shared_ptr<struct OnlineRequest> request, bool ok, const std::string& rRes) {
+  bool needed;
+  {
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    needed = request->waiters > 0;
+  }
+  if (ok && needed) {
+    struct json_object* root = json_tokener_parse(rRes.c_str());
+    if (m_pOnlineCache != NULL && root != NULL) {
+      // spam or a found name is kept longer, a number may get reported any time
+      bool spam = false;
+      std::string name;
+      (void)Helper::getObject(root, "spam", false, "script result", &spam);
+      (void)Helper::getObject(root, "name", false, "script result", &name);
+      bool positive = spam || name.length() != 0;
+      m_pOnlineCache->put(request->script->name, request->number, rRes,
+        positive ? request->positiveTtl : request->negativeTtl);
+    }
+    if (root != NULL) json_object_put(root);
   }
 
-  *root = json_tokener_parse(res.c_str());
-  return true; // script executed successful
+  // no longer joined by others, so it is known if it became a probe
+  bool probe;
+  {
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    m_inflight.erase(request->key);
+    probe = request->probe;
+  }
+
+  // answered too late counts as failed, the calls were decided without it
+  if (ok && std::chrono::steady_clock::now() - request->start <= std::chrono::milliseconds(request->deadlineMs)) {
+    m_circuitBreaker.success(request->script->name, probe);
+  } else {
+    m_circuitBreaker.failure(request->script->name, probe);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(request->mutex);
+    request->ok = ok;
+    request->res = rRes;
+    request->done = true;
+  }
+  request->cond.notify_all();
+
+  std::lock_guard<std::mutex> lock(m_pendingMutex);
+  m_pending--;
+  m_pendingCond.notify_all();
+}
+
+// false, if the deadline passed or the call was stopped before the request was done
+bool Block::waitRequest(std::shared_ptr<struct OnlineRequest> request, std::chrono::steady_clock::time_point deadline,
+                        const std::atomic<bool>* pStop) {
+  std::unique_lock<std::mutex> lock(request->mutex);
+  while (!request->done) {
+    if (pStop != NULL && *pStop) {
+      return false;
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      return false;
+    }
+    (void)request->cond.wait_until(lock, std::min(deadline, now + std::chrono::milliseconds(STOP_POLL_MS)));
+  }
+  return true;
+}
+
+bool Block::waitOnline(std::shared_ptr<struct OnlineRequest> request, std::chrono::steady_clock::time_point deadline,
+                       const std::atomic<bool>* pStop, const std::string& rScriptName, const std::string& rNumber, bool check,
+                       struct OnlineResult* pResult) {
+  if (!waitRequest(request, deadline, pStop)) {
+    if (pStop != NULL && *pStop) {
+      Logger::info("%s for number %s not waited for, the call was stopped", rScriptName.c_str(), rNumber.c_str());
+    } else {
+      Logger::warn("%s timed out for number %s, decided without it", rScriptName.c_str(), rNumber.c_str());
+    }
+    return false;
+  }
+  // ok and res are not changed anymore, once done
+  if (!request->ok) {
+    return false;
+  }
+  struct json_object* root = json_tokener_parse(request->res.c_str());
+  if (root == NULL) {
+    return false;
+  }
+
+  // a check must tell, if spam
+  pResult->spam = false;
+  pResult->name = "";
+  pResult->score = "";
+  bool ok = true;
+  if (!Helper::getObject(root, "spam", check, "script result", &pResult->spam) && check) {
+    ok = false;
+  }
+  (void)Helper::getObject(root, "name", false, "script result", &pResult->name);
+  int value;
+  if (Helper::getObject(root, "score", false, "script result", &value)) {
+    pResult->score = std::to_string(value);
+  }
+  json_object_put(root);
+  return ok;
 }
 
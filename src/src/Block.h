@@ -21,30 +21,105 @@
 #define BLOCK_H
 
 #include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <atomic>
 #include <json-c/json.h>
 
+#include "CircuitBreaker.h"
 #include "FileLists.h"
+#include "OnlineCache.h"
+#include "OnlinePlugin.h"
+#include "ScriptWorker.h"
 #include "Settings.h"
 
 
+// an online check or lookup run by a plugin or a script, shared by all calls asking the same at the same time
+struct OnlineRequest {
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool done;
+  bool ok;          // false, if the script failed
+  std::string res;  // script result
+
+  // set when started
+  std::string key;
+  std::shared_ptr<const struct SettingOnlineScript> script;
+  std::string number;
+  std::chrono::steady_clock::time_point start;
+  int positiveTtl;
+  int negativeTtl;
+  int deadlineMs;
+  bool probe;       // run for the circuit breaker, guarded by Block::m_pendingMutex
+  int waiters;      // calls that need the result, guarded by Block::m_pendingMutex
+};
+
+// fields of a script result, as far as given
+struct OnlineResult {
+  bool spam;
+  std::string name;
+  std::string score;
+};
+
 class Block {
 private:
   Settings* m_pSettings;
   FileLists* m_pWhitelists;
   FileLists* m_pBlacklists;
+  OnlineCache* m_pOnlineCache;
+  std::mutex m_workersMutex;
+  std::map<std::string, std::vector<ScriptWorker*>> m_workers;  // by script
+  size_t m_maxWorkers;  // per script, as many as calls may be decided at the same time
+  std::map<std::string, OnlinePlugin*> m_plugins;  // by script name, NULL if there is no plugin
+  std::mutex m_pendingMutex;
+  std::condition_variable m_pendingCond;
+  int m_pending;  // online requests still running
+  std::map<std::string, std::shared_ptr<struct OnlineRequest>> m_inflight;  // by "script number"
+  uint64_t m_onlineStarted;
+  uint64_t m_onlineCoalesced;
+  CircuitBreaker m_circuitBreaker;
+  // online settings, copied by reloadSettings() as the call threads must not read Settings
+  std::atomic<bool> m_scriptWorkers;
+  std::atomic<int> m_onlineDeadlineMs;
+  std::atomic<int> m_onlineCachePositiveTtl;
+  std::atomic<int> m_onlineCacheNegativeTtl;
 
 public:
   Block(Settings* pSettings);
+  Block(Settings* pSettings, const std::string& rWhitelistsDir, const std::string& rBlacklistsDir, double filterFpRate);
   virtual ~Block();
+  std::vector<int> getFDs();
   void run();
-  bool isNumberBlocked(const struct SettingBase* pSettings, const std::string& rNumber, std::string* pMsg);
-  bool isAnonymousNumberBlocked(const struct SettingBase* pSettings, std::string* pMsg);
+  void reloadSettings();
+  // pStop: when set, the call no longer waits for scripts and is decided without them, may be NULL
+  bool isNumberBlocked(const struct SettingBase* pSettings, const std::string& rNumber, const std::atomic<bool>* pStop,
+                       std::string* pMsg);
+  bool isAnonymousNumberBlocked(const struct SettingBase* pSettings, const std::atomic<bool>* pStop, std::string* pMsg);
 
 private:
+  void init(const std::string& rWhitelistsDir, const std::string& rBlacklistsDir, double filterFpRate);
   bool isWhiteListed(const struct SettingBase* pSettings, const std::string& rNumber, std::string* pListName, std::string* pName);
-  bool isBlacklisted(const struct SettingBase* pSettings, const std::string& rNumber, std::string* pListName, std::string* pName, std::string* pScore);
+  bool isBlacklisted(const struct SettingBase* pSettings, const std::string& rNumber, std::string* pListName, std::string* pName);
 
-  bool checkOnline(std::string prefix, std::string name, const std::string& rNumber, struct json_object** root);
+  void startWorkers();
+  ScriptWorker* getWorker(const std::string& rScript, size_t index);
+  bool executeScript(const std::string& rScript, const std::vector<const char*>& rArgs, std::string* pRes);
+  OnlinePlugin* getPlugin(const std::string& rScriptName);
+  std::shared_ptr<struct OnlineRequest> startOnline(const std::shared_ptr<const struct SettingOnlineScript>& rScript,
+                                                    const std::string& rNumber);
+  void releaseOnline(std::shared_ptr<struct OnlineRequest> request);
+  void runOnline(std::shared_ptr<struct OnlineRequest> request);
+  void runAnonymous(std::shared_ptr<struct OnlineRequest> request);
+  void finishOnline(std::shared_ptr<struct OnlineRequest> request, bool ok, const std::string& rRes);
+  bool waitRequest(std::shared_ptr<struct OnlineRequest> request, std::chrono::steady_clock::time_point deadline,
+                   const std::atomic<bool>* pStop);
+  bool waitOnline(std::shared_ptr<struct OnlineRequest> request, std::chrono::steady_clock::time_point deadline,
+                  const std::atomic<bool>* pStop, const std::string& rScriptName, const std::string& rNumber, bool check,
+                  struct OnlineResult* pResult);
 };
 
 #endif
@@ -0,0 +1,98 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "CircuitBreaker.h" // API
+
+#include <algorithm>
+
+#include "Logger.h"
+
+
+#define CIRCUITBREAKER_MAX_FAILURES   3
+#define CIRCUITBREAKER_COOLDOWN       30         // seconds, first cool-down
+#define CIRCUITBREAKER_MAX_COOLDOWN   (60 * 60)  // seconds
+
+
+CircuitBreaker::CircuitBreaker() {
+  Logger::debug("CircuitBreaker::CircuitBreaker()...");
+  m_maxFailures = CIRCUITBREAKER_MAX_FAILURES;
+}
+
+CircuitBreaker::~CircuitBreaker() {
+  Logger::debug("CircuitBreaker::~CircuitBreaker()...");
+}
+
+// 0 never opens the breaker
+void CircuitBreaker::setMaxFailures(unsigned int maxFailures) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_maxFailures = maxFailures;
+}
+
+enum CircuitBreakerDecision CircuitBreaker::check(const std::string& rScript) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::map<std::string, struct CircuitBreakerState>::iterator it = m_states.find(rScript);
+  if (it == m_states.end() || it->second.openUntil == 0) {
+    return CIRCUITBREAKER_RUN;
+  }
+  struct CircuitBreakerState* state = &it->second;
+  if (state->probing || time(NULL) < state->openUntil) {
+    Logger::debug("circuit breaker of %s open, skipped", rScript.c_str());
+    return CIRCUITBREAKER_SKIP;
+  }
+  Logger::info("circuit breaker of %s probing", rScript.c_str());
+  state->probing = true;
+  return CIRCUITBREAKER_PROBE;
+}
+
+// probe: the request was run for CIRCUITBREAKER_PROBE
+void CircuitBreaker::success(const std::string& rScript, bool probe) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::map<std::string, struct CircuitBreakerState>::iterator it = m_states.find(rScript);
+  if (it == m_states.end()) {
+    return;
+  }
+  if (it->second.openUntil != 0) {
+    if (!probe) {
+      return; // a request started before the breaker opened
+    }
+    Logger::info("circuit breaker of %s closed, script is back", rScript.c_str());
+  }
+  m_states.erase(it);
+}
+
+void CircuitBreaker::failure(const std::string& rScript, bool probe) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  struct CircuitBreakerState* state = &m_states[rScript]; // zero initialized, if new
+  state->failures++;
+  if (state->openUntil != 0) {
+    if (!probe) {
+      return; // a request started before the breaker opened
+    }
+    state->probing = false;
+    state->cooldown = std::min(2 * state->cooldown, (unsigned int)CIRCUITBREAKER_MAX_COOLDOWN);
+  } else if (m_maxFailures == 0 || state->failures < m_maxFailures) {
+    return;
+  } else {
+    state->cooldown = CIRCUITBREAKER_COOLDOWN;
+  }
+  state->openUntil = time(NULL) + state->cooldown;
+  Logger::warn("circuit breaker of %s open after %u failures, skipped for %u s", rScript.c_str(),
+    state->failures, state->cooldown);
+}
+
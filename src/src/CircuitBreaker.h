@@ -0,0 +1,63 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef CIRCUITBREAKER_H
+#define CIRCUITBREAKER_H
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <time.h>
+
+
+enum CircuitBreakerDecision {
+  CIRCUITBREAKER_RUN,    // script is healthy, run it
+  CIRCUITBREAKER_PROBE,  // cool-down is over, run it once in the background to see if it is back
+  CIRCUITBREAKER_SKIP    // script is failing, do not wait for it
+};
+
+struct CircuitBreakerState {
+  unsigned int failures;  // consecutive failures
+  unsigned int cooldown;  // seconds, doubled on each failed probe
+  time_t openUntil;       // skipped until then, 0 if closed
+  bool probing;
+};
+
+// Health of the online check and lookup scripts, by script. After a number
+// of consecutive failures or timeouts a script is skipped for a cool-down,
+// then probed again by a single request. A failed probe doubles the
+// cool-down, a succeeded one closes the breaker again.
+class CircuitBreaker {
+private:
+  std::mutex m_mutex;
+  std::map<std::string, struct CircuitBreakerState> m_states;
+  unsigned int m_maxFailures;
+
+public:
+  CircuitBreaker();
+  virtual ~CircuitBreaker();
+  void setMaxFailures(unsigned int maxFailures);
+
+  enum CircuitBreakerDecision check(const std::string& rScript);
+  void success(const std::string& rScript, bool probe);
+  void failure(const std::string& rScript, bool probe);
+};
+
+#endif
+
@@ -0,0 +1,98 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "EventLoop.h" // API
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "Logger.h"
+
+
+#define MAX_EVENTS   16
+
+
+EventLoop::EventLoop() {
+  Logger::debug("EventLoop::EventLoop()...");
+  m_epollFD = epoll_create1(EPOLL_CLOEXEC);
+  if (m_epollFD < 0) {
+    Logger::warn("epoll_create1 failed (%s)", strerror(errno));
+  }
+}
+
+EventLoop::~EventLoop() {
+  Logger::debug("EventLoop::~EventLoop()...");
+  if (m_epollFD >= 0) {
+    close(m_epollFD);
+    m_epollFD = -1;
+  }
+}
+
+bool EventLoop::add(int fd, const EventLoopCallback& rCallback) {
+  if (fd < 0) {
+    return false;
+  }
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN | EPOLLPRI;
+  event.data.fd = fd;
+  if (epoll_ctl(m_epollFD, EPOLL_CTL_ADD, fd, &event) < 0) {
+    Logger::warn("epoll_ctl add %d failed (%s)", fd, strerror(errno));
+    return false;
+  }
+  m_callbacks[fd] = rCallback;
+  return true;
+}
+
+void EventLoop::remove(int fd) {
+  if (m_callbacks.erase(fd) == 0) {
+    return;
+  }
+  (void)epoll_ctl(m_epollFD, EPOLL_CTL_DEL, fd, NULL);
+}
+
+void EventLoop::run() {
+  struct epoll_event events[MAX_EVENTS];
+  int num = epoll_wait(m_epollFD, events, MAX_EVENTS, -1);
+  if (num < 0) {
+    if (errno != EINTR) {
+      Logger::warn("epoll_wait failed (%s)", strerror(errno));
+    }
+    return;
+  }
+
+  for (int i = 0; i < num; i++) {
+    // a callback may have removed the file descriptors of later events
+    std::map<int, EventLoopCallback>::iterator it = m_callbacks.find(events[i].data.fd);
+    if (it == m_callbacks.end()) {
+      continue;
+    }
+    if ((events[i].events & (EPOLLIN | EPOLLPRI)) == 0) {
+      // error or hangup only, e.g. a device was removed
+      Logger::warn("file descriptor %d failed (0x%x), no longer watched", events[i].data.fd, events[i].events);
+      remove(events[i].data.fd);
+      continue;
+    }
+    EventLoopCallback callback = it->second; // copy, the callback may remove itself
+    callback();
+  }
+}
+
@@ -0,0 +1,47 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <map>
+#include <functional>
+
+
+typedef std::function<void()> EventLoopCallback;
+
+// Waits with epoll for any of the registered file descriptors to become
+// readable (inotify, tty, signalfd, timerfd, ...) and calls its callback.
+// Nothing is polled, the daemon sleeps until there is work to do.
+class EventLoop {
+private:
+  int m_epollFD;
+  std::map<int, EventLoopCallback> m_callbacks;  // by file descriptor
+
+public:
+  EventLoop();
+  virtual ~EventLoop();
+
+  bool add(int fd, const EventLoopCallback& rCallback);
+  void remove(int fd);
+  void run();  // waits for and dispatches one batch of events
+};
+
+#endif
+
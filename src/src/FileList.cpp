@@ -19,92 +19,159 @@
 
 #include "FileList.h" // API
 
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <stdio.h>
 #include <string.h>
-#include <json-c/json.h>
+#include <time.h>
+#include <sys/stat.h>
 
 #include "Logger.h"
-#include "Helper.h"
+#include "ListIndex.h"
+#include "ListParser.h"
 
 
+#define ENTRY_MIN_TEXT_SIZE   12    // {"number":""}
+
 FileList::FileList() {
   Logger::debug("FileList::FileList()...");
+  memset(&m_stat, 0, sizeof(m_stat));
+  m_valid = false;
 }
 
 FileList::~FileList() {
   Logger::debug("FileList::~FileList()... %s", m_filename.c_str());
-  m_entries.clear();
+  clearEntries();
 }
 
-bool FileList::load(const std::string& filename) {
-  m_filename = filename;
+void FileList::clearEntries() {
+  std::string().swap(m_strings);
+  std::vector<struct FileListEntry>().swap(m_entries);
+}
 
-  Logger::debug("loading file %s", m_filename.c_str());
+uint32_t FileList::addString(const std::string& rStr) {
+  uint32_t offset = m_strings.size();
+  m_strings.append(rStr);
+  m_strings.push_back('\0');
+  return offset;
+}
 
-  std::ifstream in(m_filename);
-  if (in.fail()) {
-    Logger::warn("loading file %s failed", m_filename.c_str());
-    return false;
+// pNames: offsets of the names added so far, used to store each name only once
+void FileList::addEntry(const std::string& rNumber, const std::string& rName, uint32_t expires,
+                        std::unordered_map<std::string, uint32_t>* pNames) {
+  struct FileListEntry entry;
+  entry.expires = expires;
+  entry.numberOffset = addString(rNumber);
+  std::unordered_map<std::string, uint32_t>::const_iterator it = pNames->find(rName);
+  if (it != pNames->end()) {
+    entry.nameOffset = it->second;
+  } else {
+    entry.nameOffset = addString(rName);
+    (*pNames)[rName] = entry.nameOffset;
   }
+  m_entries.push_back(entry);
+}
 
-  std::stringstream buffer;
-  buffer << in.rdbuf();
-  std::string str = buffer.str();
-
-  m_entries.clear();
-  struct json_object* root = json_tokener_parse(str.c_str());
+bool FileList::load(const std::string& filename) {
+  m_filename = filename;
+  m_valid = false;
 
-  if (!Helper::getObject(root, "name", true, m_filename, &m_name)) {
+  Logger::debug("loading file %s", m_filename.c_str());
+  (void)getStat(m_filename, &m_stat);
+
+  clearEntries();
+  // no string or entry is larger than its text in the file, reserving that much avoids
+  // the copies of growing, and pages never written do not take any memory
+  m_strings.reserve(m_stat.size);
+  m_entries.reserve(m_stat.size / ENTRY_MIN_TEXT_SIZE);
+  std::unordered_map<std::string, uint32_t> names;
+  ListParser parser;
+  bool ok = parser.parse(m_filename, &m_name, [this, &names](const struct ListParserEntry& rEntry) {
+    // the date is kept in expires, until "max_age_days" is known
+    int64_t date = rEntry.dateModified != 0 ? rEntry.dateModified : rEntry.dateCreated;
+    addEntry(rEntry.number, rEntry.name, date > 0xffffffffLL ? 0xffffffff : (date < 0 ? 1 : date), &names);
+  });
+  std::unordered_map<std::string, uint32_t>().swap(names);
+  if (!ok) {
+    // entries seen before the error are dropped, like for a file which could not be parsed at all
+    clearEntries();
     return false;
   }
 
-  struct json_object* entries;
-  if (json_object_object_get_ex(root, "entries", &entries)) {
-    for (int i = 0; i < json_object_array_length(entries); i++) {
-      struct json_object* entry = json_object_array_get_idx(entries, i);
-      
-      struct FileListEntry add;
-      if (!Helper::getObject(entry, "number", true, m_filename, &add.number)) {
-        continue;
+  // "max_age_days" may follow the entries, so the expiry is set afterwards
+  if (parser.getMaxAge() > 0) {
+    int64_t now = time(NULL);
+    size_t num = 0;
+    for(size_t i = 0; i < m_entries.size(); i++) {
+      if (m_entries[i].expires != 0) {
+        // entries without date never expire
+        int64_t expires = (int64_t)m_entries[i].expires + parser.getMaxAge();
+        m_entries[i].expires = expires > 0xffffffffLL ? 0xffffffff : expires;
       }
-      if (!Helper::getObject(entry, "name", true, m_filename, &add.name)) {
-        continue;
+      if (!isExpired(m_entries[i].expires, now)) {
+        m_entries[num++] = m_entries[i];
       }
-      m_entries.push_back(add);
+    }
+    if (num != m_entries.size()) {
+      Logger::debug("%zu expired entries of %s not loaded", m_entries.size() - num, m_filename.c_str());
+      m_entries.resize(num);
     }
   } else {
-      Logger::debug("no entries section found in json file %s", m_filename.c_str());
+    for(size_t i = 0; i < m_entries.size(); i++) {
+      m_entries[i].expires = 0;
+    }
   }
-  json_object_put(root); // free
+  m_valid = true;
   return true;
 }
 
+// takes the entries of an unchanged list file from the last compiled index, without the expired ones
+bool FileList::load(const std::string& filename, const ListIndex* pIndex, size_t list) {
+  m_filename = filename;
+  Logger::debug("loading file %s from index", m_filename.c_str());
+
+  m_stat = pIndex->getListStat(list);
+  m_valid = pIndex->isListValid(list);
+  m_name = pIndex->getListName(list);
+  clearEntries();
+  std::unordered_map<std::string, uint32_t> names;
+  int64_t now = time(NULL);
+  size_t num = pIndex->getListNumEntries(list);
+  m_entries.reserve(num);
+  for(size_t i = 0; i < num; i++) {
+    uint32_t expires = pIndex->getListEntryExpires(list, i);
+    if (!isExpired(expires, now)) {
+      addEntry(pIndex->getListNumber(list, i), pIndex->getListEntryName(list, i), expires, &names);
+    }
+  }
+  m_strings.shrink_to_fit();
+  m_entries.shrink_to_fit();
+  return m_valid;
+}
+
 std::string FileList::getName() {
   return m_name;
 }
 
-bool FileList::isListed(const std::string& number, std::string* pName) {
+void FileList::dump() {
+  printf("Name=%s:\n", m_name.c_str());
   for(size_t i = 0; i < m_entries.size(); i++) {
-    struct FileListEntry* entry = &m_entries[i];
-    const char* s = entry->number.c_str();
-    if (strncmp(s, number.c_str(), strlen(s)) == 0) {
-      Logger::debug("FileList::isListed(number='%s') matched with '%s'/'%s' in file %s",
-        number.c_str(), s, entry->name.c_str(), m_filename.c_str());
-      *pName = entry->name;
-      return true;
-    }
+    printf("'%s'/'%s'\n", getNumber(i), getEntryName(i));
   }
-  return false;
 }
 
-void FileList::dump() {
-  printf("Name=%s:\n", m_name.c_str());
-  for(size_t i = 0; i < m_entries.size(); i++) {
-    struct FileListEntry* entry = &m_entries[i];
-    printf("'%s'/'%s'\n", entry->number.c_str(), entry->name.c_str());
+bool FileList::getStat(const std::string& filename, struct FileListStat* pStat) {
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0) {
+    memset(pStat, 0, sizeof(*pStat));
+    return false;
   }
+  pStat->mtimeSec = st.st_mtim.tv_sec;
+  pStat->mtimeNsec = st.st_mtim.tv_nsec;
+  pStat->size = st.st_size;
+  return true;
+}
+
+bool FileList::isSameStat(const struct FileListStat& rA, const struct FileListStat& rB) {
+  return rA.mtimeSec == rB.mtimeSec && rA.mtimeNsec == rB.mtimeNsec && rA.size == rB.size;
 }
 
@@ -22,27 +22,64 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <stdint.h>
 
+class ListIndex;
 
+
+// identifies the version of a list file
+struct FileListStat {
+  int64_t mtimeSec;
+  int64_t mtimeNsec;
+  int64_t size;
+};
+
+// offsets of the number and name in the string arena of the list
 struct FileListEntry {
-  std::string number;
-  std::string name;
+  uint32_t numberOffset;
+  uint32_t nameOffset;
+  uint32_t expires;         // seconds since the epoch, 0 when the entry never expires
 };
 
+// entries of a list file, they get compiled into a ListIndex by FileLists
+// All strings are stored in one arena, equal names are stored only once.
+// A list with "max_age_days" lets its entries expire that long after they were
+// modified (or created), entries already expired are not loaded.
 class FileList {
 private:
   std::string m_filename;
+  struct FileListStat m_stat;
+  bool m_valid;
   std::string m_name;
-  std::vector<FileListEntry> m_entries;
+  std::string m_strings;
+  std::vector<struct FileListEntry> m_entries;
 
 public:
   FileList();
   virtual ~FileList();
 
   bool load(const std::string& filename);
+  bool load(const std::string& filename, const ListIndex* pIndex, size_t list);
+  std::string getFilename() const { return m_filename; }
+  const struct FileListStat& getStat() const { return m_stat; }
+  bool isValid() const { return m_valid; }
   std::string getName();
-  bool isListed(const std::string& number, std::string* pName);
+  size_t getNumEntries() const { return m_entries.size(); }
+  const char* getNumber(size_t pos) const { return m_strings.c_str() + m_entries[pos].numberOffset; }
+  const char* getEntryName(size_t pos) const { return m_strings.c_str() + m_entries[pos].nameOffset; }
+  uint32_t getExpires(size_t pos) const { return m_entries[pos].expires; }
   void dump();
+
+  static bool getStat(const std::string& filename, struct FileListStat* pStat);
+  static bool isSameStat(const struct FileListStat& rA, const struct FileListStat& rB);
+  static bool isExpired(uint32_t expires, int64_t now) { return expires != 0 && expires <= now; }
+
+private:
+  uint32_t addString(const std::string& rStr);
+  void addEntry(const std::string& rNumber, const std::string& rName, uint32_t expires,
+                std::unordered_map<std::string, uint32_t>* pNames);
+  void clearEntries();
 };
 
 #endif
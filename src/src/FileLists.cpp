@@ -20,58 +20,122 @@
 #include "FileLists.h" // API
 
 #include <string>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 #include <dirent.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <sys/inotify.h>
 
 #include "Logger.h"
 #include "Helper.h"
 
 
-FileLists::FileLists(const std::string& rPathname) : Notify(rPathname, IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) {
+// the compiled index lives in a sub directory, so writing it does not trigger the inotify watch
+#define INDEX_DIRNAME     ".cache"
+#define INDEX_FILENAME    "lists.idx"
+
+#define MAX_LOAD_THREADS  8
+
+
+// filterFpRate: false positive rate of the prefix filter in front of the index, 0 disables the filter
+// loadThreads: number of threads loading list files in parallel, 0 selects it by the number of CPUs
+FileLists::FileLists(const std::string& rPathname, double filterFpRate, unsigned int loadThreads)
+  : Notify(rPathname, IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO),
+    m_filterRejected(0), m_filterPassed(0), m_filterFalsePositives(0), m_compacting(false) {
   Logger::debug("FileLists::FileLists()...");
   m_pathname = rPathname;
-
-  if (pthread_mutex_init(&m_mutexLock, NULL) != 0) {
-    Logger::warn("pthread_mutex_init failed");
+  m_indexFilename = m_pathname + "/" INDEX_DIRNAME "/" INDEX_FILENAME;
+  m_filterFpRate = filterFpRate;
+  m_loadThreads = loadThreads;
+  if (m_loadThreads == 0) {
+    m_loadThreads = std::min(std::max(std::thread::hardware_concurrency(), 1U), (unsigned int)MAX_LOAD_THREADS);
   }
 
-  load();
+  load(std::set<std::string>());
 }
 
 FileLists::~FileLists() {
   Logger::debug("FileLists::~FileLists()...");
+  if (m_compactThread.joinable()) {
+    m_compactThread.join();
+  }
+  logFilterStats();
   clear();
 }
 
 void FileLists::run() {
-  if (hasChanged()) {
-    Logger::info("reload %s", m_pathname.c_str());
+  // lookups skip expired entries meanwhile
+  std::shared_ptr<const ListIndex> pIndex = std::atomic_load(&m_pIndex);
+  if (pIndex != NULL && pIndex->getNextExpiry() != 0 && time(NULL) >= pIndex->getNextExpiry() && !m_compacting) {
+    if (m_compactThread.joinable()) {
+      m_compactThread.join();
+    }
+    m_compacting = true;
+    m_compactThread = std::thread(&FileLists::compact, this);
+  }
+
+  std::vector<struct NotifyEvent> events;
+  if (!getEvents(&events)) {
+    return;
+  }
 
-    pthread_mutex_lock(&m_mutexLock);
-    clear();
-    load();
-    pthread_mutex_unlock(&m_mutexLock);
+  // created, written, deleted or renamed list files
+  std::set<std::string> changed;
+  for(size_t i = 0; i < events.size(); i++) {
+    if (events[i].mask & IN_Q_OVERFLOW) {
+      // the changed files are unknown, all files differing from the index are loaded
+      Logger::info("reload %s (events lost)", m_pathname.c_str());
+      logFilterStats();
+      load(std::set<std::string>());
+      return;
+    }
+    const std::string& name = events[i].name;
+    if (name.length() >= 5 && name.compare(name.length() - 5, 5, ".json") == 0) {
+      changed.insert(name);
+    }
   }
+  if (changed.empty()) {
+    return;
+  }
+
+  // lookups continue on the current index meanwhile
+  Logger::info("reload %s (%zu files changed)", m_pathname.c_str(), changed.size());
+  logFilterStats();
+  load(changed);
 }
 
 bool FileLists::isListed(const std::string& rNumber, std::string* pListName, std::string* pCallerName) {
-  bool ret = false;
-  pthread_mutex_lock(&m_mutexLock);
-  for(size_t i = 0; i < m_lists.size(); i++) {
-    std::string msg;
-    if (m_lists[i]->isListed(rNumber, pCallerName)) {
-      *pListName = m_lists[i]->getName();
-      ret = true;
-      break;
+  // keeps the index alive until this lookup is done, even when a reload replaces it
+  std::shared_ptr<const ListIndex> pIndex = std::atomic_load(&m_pIndex);
+  if (pIndex == NULL) {
+    return false;
+  }
+  if (pIndex->hasFilter()) {
+    if (!pIndex->mayBeListed(rNumber)) {
+      m_filterRejected++;
+      return false;
     }
+    m_filterPassed++;
   }
-  pthread_mutex_unlock(&m_mutexLock);
-  return ret;
+  if (!pIndex->isListed(rNumber, pListName, pCallerName)) {
+    if (pIndex->hasFilter()) m_filterFalsePositives++;
+    return false;
+  }
+  Logger::debug("FileLists::isListed(number='%s') matched with '%s' in list %s",
+    rNumber.c_str(), pCallerName->c_str(), pListName->c_str());
+  return true;
 }
 
-void FileLists::load() {
+// rChanged: files known to be changed, all others are only parsed when they differ from the index
+void FileLists::load(const std::set<std::string>& rChanged) {
+  std::lock_guard<std::mutex> lock(m_loadMutex);
   DIR* dir = opendir(m_pathname.c_str());
   if (dir == NULL) {
     Logger::warn("open directory %s failed", m_pathname.c_str());
@@ -79,40 +143,189 @@ void FileLists::load() {
   }
 
   Logger::debug("loading directory %s", m_pathname.c_str());
+  std::vector<std::string> filenames;
+  std::vector<struct FileListStat> stats;
   struct dirent* entry = readdir(dir);
   while (entry != NULL) {
     if ((entry->d_type & DT_DIR) == 0) {
       size_t len = strlen(entry->d_name);
       if (len >= 5 && strcmp(entry->d_name + len - 5, ".json") == 0) {
-        // only reading .json files      
-        std::string filename = m_pathname + "/";
-        filename += entry->d_name;
-        FileList* l = new FileList();
-        if (l->load(filename)) {
-          m_lists.push_back(l);
-        } else {
-          delete l;
-        }
+        // only reading .json files
+        struct FileListStat stat;
+        (void)FileList::getStat(m_pathname + "/" + entry->d_name, &stat);
+        filenames.push_back(entry->d_name);
+        stats.push_back(stat);
       }
     }
     entry = readdir(dir);
   }
   closedir(dir);
+
+  std::shared_ptr<const ListIndex> pCurrent = std::atomic_load(&m_pIndex);
+  if (pCurrent == NULL) {
+    // index compiled by a previous run
+    std::shared_ptr<ListIndex> pIndex(new ListIndex());
+    if (pIndex->open(m_indexFilename)) {
+      if (m_filterFpRate > 0) pIndex->buildFilter(m_filterFpRate);
+      pCurrent = pIndex;
+      std::atomic_store(&m_pIndex, pCurrent);
+    }
+  }
+  if (pCurrent != NULL && rChanged.empty() && isIndexUpToDate(pCurrent.get(), filenames, stats)) {
+    Logger::debug("index %s is up to date", m_indexFilename.c_str());
+    return;
+  }
+
+  // Only changed files need to be parsed, the others are taken from the current index.
+  // The files are loaded by a bounded number of threads, each result is stored at its
+  // position in the directory, so the order of the index does not depend on timing.
+  std::vector<FileList*> lists(filenames.size(), NULL);
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    size_t i;
+    while ((i = next++) < filenames.size()) {
+      std::string filename = m_pathname + "/" + filenames[i];
+      FileList* l = new FileList();
+      size_t list;
+      if (pCurrent != NULL && rChanged.count(filenames[i]) == 0 && findIndexList(pCurrent.get(), filenames[i], stats[i], &list)) {
+        (void)l->load(filename, pCurrent.get(), list);
+      } else {
+        (void)l->load(filename);
+      }
+      lists[i] = l; // failed ones are kept, so they are not parsed again while unchanged
+    }
+  };
+  size_t numThreads = std::min((size_t)m_loadThreads, filenames.size());
+  std::vector<std::thread> threads;
+  for(size_t t = 1; t < numThreads; t++) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for(size_t t = 0; t < threads.size(); t++) {
+    threads[t].join();
+  }
+
+  publish(lists);
+  for(size_t i = 0; i < lists.size(); i++) {
+    delete lists[i];
+  }
+}
+
+// compiles the index without the expired entries, no list file is parsed for it
+void FileLists::compact() {
+  {
+    std::lock_guard<std::mutex> lock(m_loadMutex);
+    std::shared_ptr<const ListIndex> pCurrent = std::atomic_load(&m_pIndex);
+    if (pCurrent != NULL) {
+      std::vector<FileList*> lists;
+      for(size_t i = 0; i < pCurrent->getNumLists(); i++) {
+        FileList* l = new FileList();
+        (void)l->load(m_pathname + "/" + pCurrent->getListFilename(i), pCurrent.get(), i);
+        lists.push_back(l);
+      }
+      publish(lists);
+      for(size_t i = 0; i < lists.size(); i++) {
+        delete lists[i];
+      }
+      std::shared_ptr<const ListIndex> pIndex = std::atomic_load(&m_pIndex);
+      Logger::info("dropped %zu expired entries of %s", pCurrent->getNumEntries() - pIndex->getNumEntries(), m_pathname.c_str());
+    }
+  }
+  m_compacting = false;
+}
+
+// compiles the lists into a new index and replaces the current one with it
+void FileLists::publish(const std::vector<FileList*>& rLists) {
+  std::string data;
+  ListIndex::create(rLists, &data);
+
+  std::shared_ptr<ListIndex> pIndex(new ListIndex());
+  if (!writeIndex(data) || !pIndex->open(m_indexFilename)) {
+    Logger::warn("using index of %s without index file", m_pathname.c_str());
+    (void)pIndex->attach(&data);
+  }
+  if (m_filterFpRate > 0) {
+    pIndex->buildFilter(m_filterFpRate);
+    Logger::debug("prefix filter of %s uses %zu bytes", m_pathname.c_str(), pIndex->getFilterSize());
+  }
+  Logger::debug("indexed %zu entries of %zu lists in %s", pIndex->getNumEntries(), pIndex->getNumLists(), m_pathname.c_str());
+  std::atomic_store(&m_pIndex, std::shared_ptr<const ListIndex>(pIndex));
 }
 
 void FileLists::clear() {
-  for(size_t i = 0; i < m_lists.size(); i++) {
-    delete m_lists[i];
+  std::atomic_store(&m_pIndex, std::shared_ptr<const ListIndex>());
+}
+
+void FileLists::getFilterStats(struct FileListsFilterStats* pStats) {
+  pStats->rejected = m_filterRejected;
+  pStats->passed = m_filterPassed;
+  pStats->falsePositives = m_filterFalsePositives;
+}
+
+void FileLists::logFilterStats() {
+  if (m_filterFpRate <= 0) {
+    return;
+  }
+  struct FileListsFilterStats stats;
+  getFilterStats(&stats);
+  Logger::info("prefix filter of %s: %llu rejected, %llu passed, %llu false positives", m_pathname.c_str(),
+    (unsigned long long)stats.rejected, (unsigned long long)stats.passed, (unsigned long long)stats.falsePositives);
+}
+
+bool FileLists::isIndexUpToDate(const ListIndex* pIndex, const std::vector<std::string>& rFilenames, const std::vector<struct FileListStat>& rStats) {
+  if (pIndex->getNumLists() != rFilenames.size()) {
+    return false;
+  }
+  for(size_t i = 0; i < rFilenames.size(); i++) {
+    if (pIndex->getListFilename(i) != rFilenames[i] || !FileList::isSameStat(pIndex->getListStat(i), rStats[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FileLists::findIndexList(const ListIndex* pIndex, const std::string& rFilename, const struct FileListStat& rStat, size_t* pList) {
+  for(size_t i = 0; i < pIndex->getNumLists(); i++) {
+    if (pIndex->getListFilename(i) == rFilename) {
+      if (!FileList::isSameStat(pIndex->getListStat(i), rStat)) {
+        return false; // source .json changed
+      }
+      *pList = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool FileLists::writeIndex(const std::string& rData) {
+  std::string dirname = m_pathname + "/" INDEX_DIRNAME;
+  if (mkdir(dirname.c_str(), 0755) != 0 && errno != EEXIST) {
+    Logger::warn("create directory %s failed (%s)", dirname.c_str(), strerror(errno));
+    return false;
+  }
+
+  // replace atomically, processes still mapping the old file keep their version
+  std::string tmpFilename = m_indexFilename + ".tmp";
+  std::ofstream out(tmpFilename.c_str(), std::ios::binary | std::ios::trunc);
+  out.write(rData.data(), rData.size());
+  out.close();
+  if (out.fail()) {
+    Logger::warn("writing index %s failed", tmpFilename.c_str());
+    (void)unlink(tmpFilename.c_str());
+    return false;
+  }
+  if (rename(tmpFilename.c_str(), m_indexFilename.c_str()) != 0) {
+    Logger::warn("rename %s failed (%s)", tmpFilename.c_str(), strerror(errno));
+    (void)unlink(tmpFilename.c_str());
+    return false;
   }
-  m_lists.clear();
+  return true;
 }
 
 void FileLists::dump() {
-  pthread_mutex_lock(&m_mutexLock);
-  for(size_t i = 0; i < m_lists.size(); i++) {
-    FileList* l = m_lists[i];
-    l->dump();
+  std::shared_ptr<const ListIndex> pIndex = std::atomic_load(&m_pIndex);
+  if (pIndex != NULL) {
+    pIndex->dump();
   }
-  pthread_mutex_unlock(&m_mutexLock);
 }
 
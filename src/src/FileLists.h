@@ -21,30 +21,62 @@
 #define FILELISTS_H
 
 #include <vector>
-#include <pthread.h>
+#include <set>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <stdint.h>
 
 #include "FileList.h"
+#include "ListIndex.h"
 #include "Notify.h"
 
 
+// counters of the prefix filter in front of the index, to tune its false positive rate
+struct FileListsFilterStats {
+  uint64_t rejected;        // numbers known to be on no list, the index was not used
+  uint64_t passed;          // numbers looked up in the index
+  uint64_t falsePositives;  // passed numbers, which are on no list
+};
+
 class FileLists : public Notify {
 private:
-  pthread_mutex_t m_mutexLock;
   std::string m_pathname;
-  std::vector<FileList*> m_lists;
+  std::string m_indexFilename;
+  unsigned int m_loadThreads;
+  double m_filterFpRate;
+  std::atomic<uint64_t> m_filterRejected;
+  std::atomic<uint64_t> m_filterPassed;
+  std::atomic<uint64_t> m_filterFalsePositives;
+  // one index over the entries of all lists, compiled into m_indexFilename.
+  // It is immutable, a reload publishes a new one with std::atomic_store and
+  // the old one is freed, when the last lookup using it has finished.
+  std::shared_ptr<const ListIndex> m_pIndex;
+  // serializes reloads with the compaction, which drops expired entries in the background
+  std::mutex m_loadMutex;
+  std::thread m_compactThread;
+  std::atomic<bool> m_compacting;
 
 public:
-  FileLists(const std::string& rDirname);
+  FileLists(const std::string& rDirname, double filterFpRate = 0, unsigned int loadThreads = 0);
   virtual ~FileLists();
   void run();
 
   bool isListed(const std::string& rNumber, std::string* pListName, std::string* pCallerName);
+  void getFilterStats(struct FileListsFilterStats* pStats);
 
   void dump();
 
 private:
-  void load();
+  void load(const std::set<std::string>& rChanged);
+  void compact();
+  void publish(const std::vector<FileList*>& rLists);
   void clear();
+  void logFilterStats();
+  static bool isIndexUpToDate(const ListIndex* pIndex, const std::vector<std::string>& rFilenames, const std::vector<struct FileListStat>& rStats);
+  static bool findIndexList(const ListIndex* pIndex, const std::string& rFilename, const struct FileListStat& rStat, size_t* pList);
+  bool writeIndex(const std::string& rData);
 };
 
 #endif
@@ -19,7 +19,15 @@
 
 #include "Helper.h" // API
 
+#include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/wait.h>
 #include <boost/algorithm/string.hpp>
 
 #include "Logger.h"
@@ -70,6 +78,21 @@ bool Helper::getObject(struct json_object* objbase, const char* objname, bool lo
   return true;
 }
 
+bool Helper::getObject(struct json_object* objbase, const char* objname, bool logError, const std::string& rLocation, double* pRes) {
+  struct json_object* n;
+  *pRes = 0;
+  if (!json_object_object_get_ex(objbase, objname, &n)) {
+    if (logError) Logger::warn("%s not found in %s", objname, rLocation.c_str());
+    return false;
+  }
+  if (json_object_get_type(n) != json_type_double && json_object_get_type(n) != json_type_int) {
+    if (logError) Logger::warn("number type expected for %s in %s", objname, rLocation.c_str());
+    return false;
+  }
+  *pRes = json_object_get_double(n);
+  return true;
+}
+
 bool Helper::executeCommand(const std::string& rCmd, std::string* pRes) {
   Logger::debug("executing(%s)...", rCmd.c_str());
 
@@ -97,6 +120,106 @@ bool Helper::executeCommand(const std::string& rCmd, std::string* pRes) {
   return true;
 }
 
+static long getElapsedMs(const struct timespec& rStart) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - rStart.tv_sec) * 1000 + (now.tv_nsec - rStart.tv_nsec) / 1000000;
+}
+
+// like executeCommand, but the arguments are passed as they are, without a shell
+// timeoutMs: the program is killed, when it has not finished by then
+bool Helper::executeProgram(const std::string& rProgram, const std::vector<const char*>& rArgs, int timeoutMs, std::string* pRes) {
+  std::string cmd = rProgram;
+  std::vector<char*> argv;
+  argv.push_back((char*)rProgram.c_str());
+  for(size_t i = 0; i < rArgs.size(); i++) {
+    cmd += " ";
+    cmd += rArgs[i];
+    argv.push_back((char*)rArgs[i]);
+  }
+  argv.push_back(NULL);
+  Logger::debug("executing(%s)...", cmd.c_str());
+
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0) {
+    Logger::warn("pipe failed (%s)", strerror(errno));
+    return false;
+  }
+  pid_t pid = fork();
+  if (pid < 0) {
+    Logger::warn("fork failed (%s)", strerror(errno));
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+  if (pid == 0) {
+    // dup2() clears close-on-exec of the copies
+    dup2(fds[1], STDOUT_FILENO);
+    dup2(fds[1], STDERR_FILENO);
+    // the signals read by the main loop are blocked, but not for the script
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigprocmask(SIG_SETMASK, &signals, NULL);
+    // own process group, so a timeout also kills the children of the script
+    setpgid(0, 0);
+    execv(argv[0], &argv[0]);
+    _exit(127);
+  }
+  setpgid(pid, pid); // also here, as the child may not have run yet
+  close(fds[1]);
+
+  std::string res = "";
+  char buf[128];
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  bool timeout = false;
+  for (;;) {
+    long elapsedMs = getElapsedMs(start);
+    if (elapsedMs >= timeoutMs) {
+      timeout = true;
+      break;
+    }
+    struct pollfd pfd = {fds[0], POLLIN, 0};
+    int ret = poll(&pfd, 1, timeoutMs - elapsedMs);
+    if (ret < 0 && errno == EINTR) continue;
+    if (ret < 0) {
+      Logger::warn("poll failed (%s)", strerror(errno));
+      timeout = true;
+      break;
+    }
+    if (ret == 0) continue;
+    ssize_t len = read(fds[0], buf, sizeof(buf));
+    if (len < 0 && errno == EINTR) continue;
+    if (len <= 0) break;
+    res.append(buf, len);
+  }
+  close(fds[0]);
+  boost::algorithm::trim(res);
+
+  // the output may be closed before the program ends
+  int status = -1;
+  pid_t ret;
+  while (!timeout && (ret = waitpid(pid, &status, WNOHANG)) != pid) {
+    if (ret < 0 && errno != EINTR) break;
+    if (getElapsedMs(start) >= timeoutMs) timeout = true;
+    else usleep(10000);
+  }
+  if (timeout) {
+    if (kill(-pid, SIGKILL) < 0) kill(pid, SIGKILL);
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    Logger::warn("%s timed out", cmd.c_str());
+    return false;
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    Logger::warn("%s failed (%s)", cmd.c_str(), res.c_str());
+    return false;
+  }
+
+  Logger::debug("result: %s", res.c_str());
+  *pRes = res;
+  return true;
+}
+
 std::string Helper::getPjStatusAsString(pj_status_t status) {
   static char buf[100];
   pj_str_t pjstr = pj_strerror(status, buf, sizeof(buf)); 
@@ -123,6 +246,24 @@ std::string Helper::escapeSqString(const std::string& rStr) {
   return escaped;
 }
 
+std::string Helper::escapeJsonString(const std::string& rStr) {
+  std::string res;
+  for(size_t i = 0; i < rStr.length(); i++) {
+    unsigned char c = rStr[i];
+    if (c == '"' || c == '\\') {
+      res.push_back('\\');
+      res.push_back(c);
+    } else if (c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      res += buf;
+    } else {
+      res.push_back(c);
+    }
+  }
+  return res;
+}
+
 std::string Helper::makeNumberInternational(const struct SettingBase* pSettings, const std::string& rNumber) {
   std::string res;
   if (boost::starts_with(rNumber, "00")) res = "+" + rNumber.substr(2);
@@ -18,6 +18,7 @@
 */
 
 #include <string>
+#include <vector>
 #include <json-c/json.h>
 #include <pjsua-lib/pjsua.h>
 
@@ -29,13 +30,16 @@ public:
   static bool getObject(struct json_object* objbase, const char* objname, bool logError, const std::string& rLocation, std::string* pRes);
   static bool getObject(struct json_object* objbase, const char* objname, bool logError, const std::string& rLocation, int* pRes);
   static bool getObject(struct json_object* objbase, const char* objname, bool logError, const std::string& rLocation, bool* pRes);
+  static bool getObject(struct json_object* objbase, const char* objname, bool logError, const std::string& rLocation, double* pRes);
 
   static bool executeCommand(const std::string& rCmd, std::string* pRes);
+  static bool executeProgram(const std::string& rProgram, const std::vector<const char*>& rArgs, int timeoutMs, std::string* pRes);
 
   static std::string getPjStatusAsString(pj_status_t status);
 
   static std::string getBaseFilename(const std::string& rFilename);
   static std::string escapeSqString(const std::string& rStr);
+  static std::string escapeJsonString(const std::string& rStr);
 
   static std::string makeNumberInternational(const struct SettingBase* pSettings, const std::string& rNumber);
 };
@@ -0,0 +1,415 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "ListIndex.h" // API
+
+#include <string>
+#include <unordered_map>
+#include <deque>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Logger.h"
+#include "Helper.h"
+#include "NumberPattern.h"
+
+
+#define ALIGN(x)    (((x) + 7) & ~(size_t)7)
+
+
+static uint32_t addString(std::string* pStrings, const std::string& rStr) {
+  uint32_t offset = pStrings->size();
+  pStrings->append(rStr);
+  pStrings->push_back('\0');
+  return offset;
+}
+
+// equal strings (names of entries and lists) are stored only once
+static uint32_t addSharedString(std::string* pStrings, std::unordered_map<std::string, uint32_t>* pShared, const std::string& rStr) {
+  std::unordered_map<std::string, uint32_t>::const_iterator it = pShared->find(rStr);
+  if (it != pShared->end()) {
+    return it->second;
+  }
+  uint32_t offset = addString(pStrings, rStr);
+  (*pShared)[rStr] = offset;
+  return offset;
+}
+
+static void putSection(std::string* pData, size_t* pPos, const void* pSrc, size_t size, uint32_t* pOffset) {
+  *pOffset = *pPos;
+  if (size != 0) memcpy(&(*pData)[*pPos], pSrc, size);
+  *pPos = ALIGN(*pPos + size);
+}
+
+
+// keys longer than the trie supports would be dropped by NumberTrie::build()
+static bool isIndexable(const std::vector<std::string>& rKeys) {
+  for(size_t i = 0; i < rKeys.size(); i++) {
+    if (rKeys[i].length() > NUMBERTRIE_MAX_KEY_LENGTH) return false;
+  }
+  return true;
+}
+
+// like the trie, a wildcard of a key matches any digit
+static bool startsWithKey(const std::string& rNumber, const std::string& rKey) {
+  if (rKey.length() > rNumber.length()) {
+    return false;
+  }
+  for(size_t i = 0; i < rKey.length(); i++) {
+    if (rKey[i] == NUMBERPATTERN_WILDCARD ? (rNumber[i] < '0' || rNumber[i] > '9') : rKey[i] != rNumber[i]) return false;
+  }
+  return true;
+}
+
+// entries not in the trie, patterns are compiled for each lookup, as there are hardly any
+static bool matchesUnindexed(const char* pEntry, const std::string& rNumber) {
+  std::vector<std::string> keys;
+  if (NumberPattern::isPattern(pEntry) && NumberPattern::compile(pEntry, &keys)) {
+    for(size_t i = 0; i < keys.size(); i++) {
+      if (startsWithKey(rNumber, keys[i])) return true;
+    }
+    return false;
+  }
+  return strncmp(pEntry, rNumber.c_str(), strlen(pEntry)) == 0;
+}
+
+
+ListIndex::ListIndex() {
+  Logger::debug("ListIndex::ListIndex()...");
+  m_pMap = NULL;
+  m_mapSize = 0;
+  m_pHeader = NULL;
+  m_pLists = NULL;
+  m_pEntries = NULL;
+  m_pUnindexed = NULL;
+  m_pStrings = NULL;
+}
+
+ListIndex::~ListIndex() {
+  Logger::debug("ListIndex::~ListIndex()...");
+  close();
+}
+
+void ListIndex::close() {
+  m_trie.clear();
+  m_filter.clear();
+  if (m_pMap != NULL) {
+    (void)munmap(m_pMap, m_mapSize);
+    m_pMap = NULL;
+    m_mapSize = 0;
+  }
+  m_data.clear();
+  m_pHeader = NULL;
+}
+
+void ListIndex::create(const std::vector<FileList*>& rLists, std::string* pData) {
+  std::string strings;
+  strings.push_back('\0');
+  std::unordered_map<std::string, uint32_t> shared;
+  std::vector<struct ListIndexList> lists;
+  std::vector<struct ListIndexEntry> entries;
+  std::vector<const char*> keys;
+  std::vector<uint32_t> values;
+  std::deque<std::string> compiled; // keeps the keys of patterns at a fixed address
+  std::vector<std::string> patternKeys;
+  std::vector<uint32_t> unindexed;
+  uint32_t nextExpiry = 0;
+
+  for(size_t i = 0; i < rLists.size(); i++) {
+    FileList* l = rLists[i];
+    struct ListIndexList list;
+    memset(&list, 0, sizeof(list));
+    list.filenameOffset = addString(&strings, Helper::getBaseFilename(l->getFilename()));
+    list.nameOffset = addSharedString(&strings, &shared, l->getName());
+    list.firstEntry = entries.size();
+    list.flags = l->isValid() ? 0 : LISTINDEX_LIST_INVALID;
+    list.stat = l->getStat();
+
+    for(size_t j = 0; j < l->getNumEntries(); j++) {
+      const char* number = l->getNumber(j);
+      if (NumberPattern::isPattern(number)) {
+        // the compiled keys of a pattern all lead to its entry
+        patternKeys.clear();
+        if (!NumberPattern::compile(number, &patternKeys)) {
+          Logger::warn("invalid number pattern '%s' in %s", number, l->getFilename().c_str());
+          unindexed.push_back(entries.size());
+        } else if (!isIndexable(patternKeys)) {
+          Logger::warn("number pattern '%s' in %s is too long to be indexed", number, l->getFilename().c_str());
+          unindexed.push_back(entries.size());
+        } else {
+          for(size_t k = 0; k < patternKeys.size(); k++) {
+            compiled.push_back(patternKeys[k]);
+            keys.push_back(compiled.back().c_str());
+            values.push_back(entries.size());
+          }
+        }
+      } else if (NumberTrie::isIndexable(number)) {
+        keys.push_back(number);
+        values.push_back(entries.size());
+      } else {
+        unindexed.push_back(entries.size());
+      }
+      struct ListIndexEntry entry;
+      entry.numberOffset = addString(&strings, number);
+      entry.nameOffset = addSharedString(&strings, &shared, l->getEntryName(j));
+      entry.expires = l->getExpires(j);
+      if (entry.expires != 0 && (nextExpiry == 0 || entry.expires < nextExpiry)) nextExpiry = entry.expires;
+      entries.push_back(entry);
+    }
+    list.numEntries = entries.size() - list.firstEntry;
+    lists.push_back(list);
+  }
+
+  shared.clear();
+  NumberTrie trie;
+  trie.build(keys, values);
+  std::vector<const char*>().swap(keys);
+  std::vector<uint32_t>().swap(values);
+  compiled.clear();
+
+  size_t listsSize = lists.size() * sizeof(struct ListIndexList);
+  size_t entriesSize = entries.size() * sizeof(struct ListIndexEntry);
+  size_t nodesSize = trie.getNumNodes() * sizeof(struct NumberTrieNode);
+  size_t labelsSize = trie.getNumLabels() * sizeof(uint64_t);
+  size_t unindexedSize = unindexed.size() * sizeof(uint32_t);
+  size_t total = ALIGN(sizeof(struct ListIndexHeader)) + ALIGN(listsSize) + ALIGN(entriesSize) +
+    ALIGN(nodesSize) + ALIGN(labelsSize) + ALIGN(unindexedSize) + ALIGN(strings.size());
+
+  struct ListIndexHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, LISTINDEX_MAGIC, sizeof(header.magic));
+  header.version = LISTINDEX_VERSION;
+  header.totalSize = total;
+  header.numLists = lists.size();
+  header.numEntries = entries.size();
+  header.numNodes = trie.getNumNodes();
+  header.numLabels = trie.getNumLabels();
+  header.numUnindexed = unindexed.size();
+  header.stringsSize = strings.size();
+  header.nextExpiry = nextExpiry;
+
+  pData->assign(total, '\0');
+  size_t pos = ALIGN(sizeof(struct ListIndexHeader));
+  putSection(pData, &pos, lists.data(), listsSize, &header.listsOffset);
+  putSection(pData, &pos, entries.data(), entriesSize, &header.entriesOffset);
+  putSection(pData, &pos, trie.getNodes(), nodesSize, &header.nodesOffset);
+  putSection(pData, &pos, trie.getLabels(), labelsSize, &header.labelsOffset);
+  putSection(pData, &pos, unindexed.data(), unindexedSize, &header.unindexedOffset);
+  putSection(pData, &pos, strings.data(), strings.size(), &header.stringsOffset);
+  memcpy(&(*pData)[0], &header, sizeof(header));
+
+  Logger::debug("ListIndex::create() %zu lists, %zu entries, %zu bytes", lists.size(), entries.size(), total);
+}
+
+bool ListIndex::open(const std::string& rFilename) {
+  close();
+
+  int fd = ::open(rFilename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    if (errno != ENOENT) Logger::warn("open index %s failed (%s)", rFilename.c_str(), strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(struct ListIndexHeader)) {
+    Logger::warn("invalid index %s", rFilename.c_str());
+    ::close(fd);
+    return false;
+  }
+  void* p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    Logger::warn("mmap index %s failed (%s)", rFilename.c_str(), strerror(errno));
+    return false;
+  }
+  m_pMap = p;
+  m_mapSize = st.st_size;
+
+  if (!setup((const char*)p, st.st_size)) {
+    Logger::warn("invalid index %s", rFilename.c_str());
+    close();
+    return false;
+  }
+  Logger::debug("mapped index %s (%zu bytes)", rFilename.c_str(), m_mapSize);
+  return true;
+}
+
+bool ListIndex::attach(std::string* pData) {
+  close();
+  m_data.swap(*pData);
+  if (!setup(m_data.data(), m_data.size())) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool ListIndex::setup(const char* pBase, size_t size) {
+  const struct ListIndexHeader* h = (const struct ListIndexHeader*)pBase;
+  if (memcmp(h->magic, LISTINDEX_MAGIC, sizeof(h->magic)) != 0 || h->version != LISTINDEX_VERSION ||
+      h->totalSize != size) {
+    return false;
+  }
+  if ((uint64_t)h->listsOffset + (uint64_t)h->numLists * sizeof(struct ListIndexList) > size ||
+      (uint64_t)h->entriesOffset + (uint64_t)h->numEntries * sizeof(struct ListIndexEntry) > size ||
+      (uint64_t)h->nodesOffset + (uint64_t)h->numNodes * sizeof(struct NumberTrieNode) > size ||
+      (uint64_t)h->labelsOffset + (uint64_t)h->numLabels * sizeof(uint64_t) > size ||
+      (uint64_t)h->unindexedOffset + (uint64_t)h->numUnindexed * sizeof(uint32_t) > size ||
+      (uint64_t)h->stringsOffset + h->stringsSize > size ||
+      h->stringsSize == 0 || pBase[h->stringsOffset + h->stringsSize - 1] != '\0') {
+    return false;
+  }
+  if (((h->listsOffset | h->entriesOffset | h->nodesOffset | h->labelsOffset | h->unindexedOffset) & 7) != 0) {
+    return false;
+  }
+
+  // offsets within the sections, lookups use them unchecked
+  const struct ListIndexList* lists = (const struct ListIndexList*)(pBase + h->listsOffset);
+  uint64_t next = 0;
+  for(size_t i = 0; i < h->numLists; i++) {
+    if (lists[i].firstEntry != next || lists[i].filenameOffset >= h->stringsSize || lists[i].nameOffset >= h->stringsSize) {
+      return false;
+    }
+    next += lists[i].numEntries;
+  }
+  if (next != h->numEntries) {
+    return false;
+  }
+  const struct ListIndexEntry* entries = (const struct ListIndexEntry*)(pBase + h->entriesOffset);
+  for(size_t i = 0; i < h->numEntries; i++) {
+    if (entries[i].numberOffset >= h->stringsSize || entries[i].nameOffset >= h->stringsSize) {
+      return false;
+    }
+  }
+  const uint32_t* unindexed = (const uint32_t*)(pBase + h->unindexedOffset);
+  for(size_t i = 0; i < h->numUnindexed; i++) {
+    if (unindexed[i] >= h->numEntries) {
+      return false;
+    }
+  }
+  NumberTrie trie;
+  trie.attach((const struct NumberTrieNode*)(pBase + h->nodesOffset), h->numNodes,
+              (const uint64_t*)(pBase + h->labelsOffset), h->numLabels);
+  if (!trie.isValid(h->numEntries)) {
+    return false;
+  }
+
+  m_pHeader = h;
+  m_pLists = (const struct ListIndexList*)(pBase + h->listsOffset);
+  m_pEntries = (const struct ListIndexEntry*)(pBase + h->entriesOffset);
+  m_pUnindexed = (const uint32_t*)(pBase + h->unindexedOffset);
+  m_pStrings = pBase + h->stringsOffset;
+  m_trie.attach((const struct NumberTrieNode*)(pBase + h->nodesOffset), h->numNodes,
+                (const uint64_t*)(pBase + h->labelsOffset), h->numLabels);
+  return true;
+}
+
+std::string ListIndex::getListFilename(size_t list) const {
+  return m_pStrings + m_pLists[list].filenameOffset;
+}
+
+std::string ListIndex::getListName(size_t list) const {
+  return m_pStrings + m_pLists[list].nameOffset;
+}
+
+const char* ListIndex::getListNumber(size_t list, size_t pos) const {
+  return m_pStrings + m_pEntries[m_pLists[list].firstEntry + pos].numberOffset;
+}
+
+const char* ListIndex::getListEntryName(size_t list, size_t pos) const {
+  return m_pStrings + m_pEntries[m_pLists[list].firstEntry + pos].nameOffset;
+}
+
+// the filter is held in memory only, it has to be built before the index is shared
+void ListIndex::buildFilter(double fpRate) {
+  if (m_pHeader == NULL) {
+    return;
+  }
+  // a pattern is represented by the part all its numbers start with
+  std::vector<const char*> keys;
+  std::vector<size_t> lengths;
+  keys.reserve(m_pHeader->numEntries);
+  lengths.reserve(m_pHeader->numEntries);
+  for(size_t i = 0; i < m_pHeader->numEntries; i++) {
+    const char* number = m_pStrings + m_pEntries[i].numberOffset;
+    keys.push_back(number);
+    lengths.push_back(NumberPattern::getLiteralPrefixLength(number));
+  }
+  m_filter.build(keys, lengths, fpRate);
+}
+
+bool ListIndex::isListed(const std::string& rNumber, std::string* pListName, std::string* pCallerName) const {
+  if (m_pHeader == NULL) {
+    return false;
+  }
+
+  // only once an entry has expired, the matches have to be checked
+  int64_t now = m_pHeader->nextExpiry != 0 ? time(NULL) : 0;
+  bool expiry = m_pHeader->nextExpiry != 0 && now >= m_pHeader->nextExpiry;
+
+  uint32_t value;
+  bool ret;
+  if (expiry) {
+    ret = m_trie.find(rNumber, &value, [this, now](uint32_t v) { return !isExpired(v, now); });
+  } else {
+    ret = m_trie.find(rNumber, &value);
+  }
+  for(size_t i = 0; i < m_pHeader->numUnindexed; i++) {
+    if (ret && m_pUnindexed[i] > value) break;
+    if (expiry && isExpired(m_pUnindexed[i], now)) continue;
+    if (matchesUnindexed(m_pStrings + m_pEntries[m_pUnindexed[i]].numberOffset, rNumber)) {
+      value = m_pUnindexed[i];
+      ret = true;
+      break;
+    }
+  }
+  if (!ret) {
+    return false;
+  }
+
+  // the last list starting at or before value
+  size_t lo = 0, hi = m_pHeader->numLists;
+  while (hi - lo > 1) {
+    size_t mid = (lo + hi) / 2;
+    if (m_pLists[mid].firstEntry <= value) lo = mid;
+    else hi = mid;
+  }
+  *pListName = getListName(lo);
+  *pCallerName = m_pStrings + m_pEntries[value].nameOffset;
+  return true;
+}
+
+void ListIndex::dump() const {
+  if (m_pHeader == NULL) {
+    return;
+  }
+  for(size_t i = 0; i < m_pHeader->numLists; i++) {
+    const struct ListIndexList* l = &m_pLists[i];
+    printf("Name=%s:\n", m_pStrings + l->nameOffset);
+    for(uint32_t j = l->firstEntry; j < l->firstEntry + l->numEntries; j++) {
+      printf("'%s'/'%s'\n", m_pStrings + m_pEntries[j].numberOffset, m_pStrings + m_pEntries[j].nameOffset);
+    }
+  }
+}
+
@@ -0,0 +1,130 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef LISTINDEX_H
+#define LISTINDEX_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "FileList.h"
+#include "NumberTrie.h"
+#include "PrefixFilter.h"
+
+
+#define LISTINDEX_MAGIC           "CBLIDX\0"
+#define LISTINDEX_VERSION         5
+
+#define LISTINDEX_LIST_INVALID    0x01  // list file failed to load, it has no entries
+
+
+// Binary index file layout (native byte order, all offsets are relative to the
+// start of the file and aligned to 8 bytes):
+// header | lists | entries | trie nodes | trie labels | unindexed entries | string table
+struct ListIndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t totalSize;
+  uint32_t numLists;
+  uint32_t listsOffset;
+  uint32_t numEntries;
+  uint32_t entriesOffset;
+  uint32_t numNodes;
+  uint32_t nodesOffset;
+  uint32_t numLabels;       // 64 bit words
+  uint32_t labelsOffset;
+  uint32_t numUnindexed;
+  uint32_t unindexedOffset;
+  uint32_t stringsSize;
+  uint32_t stringsOffset;
+  uint32_t nextExpiry;      // earliest expiry of all entries, 0 when none expires
+  uint32_t reserved;
+};
+
+struct ListIndexList {
+  uint32_t filenameOffset;  // base name of the list file, in the string table
+  uint32_t nameOffset;
+  uint32_t firstEntry;
+  uint32_t numEntries;
+  uint32_t flags;
+  uint32_t reserved;
+  struct FileListStat stat;
+};
+
+struct ListIndexEntry {
+  uint32_t numberOffset;
+  uint32_t nameOffset;
+  uint32_t expires;         // see FileListEntry
+};
+
+// Immutable index over the entries of all lists of a directory. It is either
+// memory mapped from its index file, thus shared with all other processes
+// mapping the same file, or held in memory when the file could not be written.
+// The value of an entry is its position over all lists, a lower value wins.
+// Expired entries are skipped by lookups, until FileLists compacts the index.
+class ListIndex {
+private:
+  void* m_pMap;
+  size_t m_mapSize;
+  std::string m_data;
+
+  const struct ListIndexHeader* m_pHeader;
+  const struct ListIndexList* m_pLists;
+  const struct ListIndexEntry* m_pEntries;
+  const uint32_t* m_pUnindexed;
+  const char* m_pStrings;
+  NumberTrie m_trie;
+  PrefixFilter m_filter;
+
+public:
+  ListIndex();
+  virtual ~ListIndex();
+
+  static void create(const std::vector<FileList*>& rLists, std::string* pData);
+  bool open(const std::string& rFilename);
+  bool attach(std::string* pData);
+
+  size_t getNumLists() const { return m_pHeader->numLists; }
+  size_t getNumEntries() const { return m_pHeader->numEntries; }
+  std::string getListFilename(size_t list) const;
+  std::string getListName(size_t list) const;
+  const struct FileListStat& getListStat(size_t list) const { return m_pLists[list].stat; }
+  bool isListValid(size_t list) const { return (m_pLists[list].flags & LISTINDEX_LIST_INVALID) == 0; }
+  size_t getListNumEntries(size_t list) const { return m_pLists[list].numEntries; }
+  const char* getListNumber(size_t list, size_t pos) const;
+  const char* getListEntryName(size_t list, size_t pos) const;
+  uint32_t getListEntryExpires(size_t list, size_t pos) const { return m_pEntries[m_pLists[list].firstEntry + pos].expires; }
+  uint32_t getNextExpiry() const { return m_pHeader->nextExpiry; }
+
+  void buildFilter(double fpRate);
+  bool hasFilter() const { return !m_filter.isEmpty(); }
+  size_t getFilterSize() const { return m_filter.getSize(); }
+  bool mayBeListed(const std::string& rNumber) const { return m_filter.isEmpty() || m_filter.mayContainPrefixOf(rNumber); }
+  bool isListed(const std::string& rNumber, std::string* pListName, std::string* pCallerName) const;
+  void dump() const;
+
+private:
+  bool setup(const char* pBase, size_t size);
+  bool isExpired(uint32_t value, int64_t now) const { return FileList::isExpired(m_pEntries[value].expires, now); }
+  void close();
+};
+
+#endif
+
@@ -0,0 +1,413 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "ListParser.h" // API
+
+#include <string>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Logger.h"
+
+
+ListParser::ListParser() : m_buffer(LISTPARSER_BUFFER_SIZE) {
+  m_fd = -1;
+  m_pos = 0;
+  m_len = 0;
+  m_line = 1;
+  m_maxAge = 0;
+}
+
+ListParser::~ListParser() {
+  close();
+}
+
+void ListParser::close() {
+  if (m_fd >= 0) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+}
+
+bool ListParser::parse(const std::string& rFilename, std::string* pName, EntryCallback onEntry) {
+  close();
+  m_filename = rFilename;
+  m_pos = 0;
+  m_len = 0;
+  m_line = 1;
+  m_maxAge = 0;
+  *pName = "";
+
+  m_fd = open(m_filename.c_str(), O_RDONLY);
+  if (m_fd < 0) {
+    Logger::warn("loading file %s failed (%s)", m_filename.c_str(), strerror(errno));
+    return false;
+  }
+
+  bool hasName = false;
+  bool ok = expect('{');
+  skipSpace();
+  if (ok && peekChar() == '}') {
+    (void)getChar();
+  } else {
+    while (ok) {
+      std::string key;
+      ok = readString(&key) && expect(':');
+      if (!ok) break;
+      skipSpace();
+      if (key == "name" && peekChar() == '"') {
+        ok = readString(pName);
+        hasName = true;
+      } else if (key == "max_age_days" && (peekChar() == '-' || (peekChar() >= '0' && peekChar() <= '9'))) {
+        double days;
+        ok = readNumber(&days);
+        if (ok && days > 0 && days < 100000) {
+          m_maxAge = (int64_t)(days * 24 * 60 * 60);
+        } else if (ok && days != 0) {
+          Logger::warn("ignoring max_age_days %g in %s", days, m_filename.c_str());
+        }
+      } else if (key == "entries" && peekChar() == '[') {
+        ok = parseEntries(onEntry);
+      } else {
+        ok = skipValue();
+      }
+      if (!ok) break;
+
+      skipSpace();
+      int c = getChar();
+      if (c == '}') break;
+      ok = (c == ',');
+      // a trailing comma is accepted like json-c does
+      skipSpace();
+      if (ok && peekChar() == '}') {
+        (void)getChar();
+        break;
+      }
+    }
+  }
+  skipSpace();
+  if (ok && peekChar() != -1) {
+    ok = false;
+  }
+  close();
+
+  if (!ok) {
+    Logger::warn("invalid json in file %s (line %d)", m_filename.c_str(), m_line);
+    return false;
+  }
+  if (!hasName) {
+    Logger::warn("name not found in %s", m_filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool ListParser::parseEntries(EntryCallback onEntry) {
+  if (!expect('[')) {
+    return false;
+  }
+  skipSpace();
+  if (peekChar() == ']') {
+    (void)getChar();
+    return true;
+  }
+
+  struct ListParserEntry entry;
+  while (true) {
+    skipSpace();
+    if (peekChar() == '{') {
+      bool complete;
+      if (!parseEntry(&entry, &complete)) return false;
+      if (complete) onEntry(entry);
+    } else {
+      Logger::warn("object expected for entry in %s (line %d)", m_filename.c_str(), m_line);
+      if (!skipValue()) return false;
+    }
+
+    skipSpace();
+    int c = getChar();
+    if (c == ']') return true;
+    if (c != ',') return false;
+    skipSpace();
+    if (peekChar() == ']') {
+      (void)getChar();
+      return true;
+    }
+  }
+}
+
+// pComplete: false, when the number or name is missing, the entry is then ignored
+bool ListParser::parseEntry(struct ListParserEntry* pEntry, bool* pComplete) {
+  pEntry->number.clear();
+  pEntry->name.clear();
+  pEntry->dateCreated = 0;
+  pEntry->dateModified = 0;
+  bool hasNumber = false, hasName = false;
+
+  if (!expect('{')) {
+    return false;
+  }
+  skipSpace();
+  if (peekChar() == '}') {
+    (void)getChar();
+  } else {
+    while (true) {
+      std::string key;
+      if (!readString(&key) || !expect(':')) return false;
+      skipSpace();
+      if (key == "number" && peekChar() == '"') {
+        if (!readString(&pEntry->number)) return false;
+        hasNumber = true;
+      } else if (key == "name" && peekChar() == '"') {
+        if (!readString(&pEntry->name)) return false;
+        hasName = true;
+      } else if ((key == "date_created" || key == "date_modified") && peekChar() == '"') {
+        std::string date;
+        if (!readString(&date)) return false;
+        int64_t* res = key == "date_created" ? &pEntry->dateCreated : &pEntry->dateModified;
+        if (!parseDate(date, res)) {
+          Logger::warn("invalid %s '%s' in %s (line %d)", key.c_str(), date.c_str(), m_filename.c_str(), m_line);
+        }
+      } else {
+        if (!skipValue()) return false;
+      }
+
+      skipSpace();
+      int c = getChar();
+      if (c == '}') break;
+      if (c != ',') return false;
+      skipSpace();
+      if (peekChar() == '}') {
+        (void)getChar();
+        break;
+      }
+    }
+  }
+
+  if (!hasNumber) {
+    Logger::warn("string number not found in %s (line %d)", m_filename.c_str(), m_line);
+  } else if (!hasName) {
+    Logger::warn("string name not found in %s (line %d)", m_filename.c_str(), m_line);
+  }
+  *pComplete = hasNumber && hasName;
+  return true;
+}
+
+int ListParser::peekChar() {
+  if (m_pos == m_len) {
+    if (m_fd < 0) return -1;
+    ssize_t len;
+    do {
+      len = read(m_fd, &m_buffer[0], m_buffer.size());
+    } while (len < 0 && errno == EINTR);
+    if (len <= 0) {
+      if (len < 0) Logger::warn("reading file %s failed (%s)", m_filename.c_str(), strerror(errno));
+      close();
+      return -1;
+    }
+    m_pos = 0;
+    m_len = len;
+  }
+  return (unsigned char)m_buffer[m_pos];
+}
+
+int ListParser::getChar() {
+  int c = peekChar();
+  if (c != -1) {
+    m_pos++;
+    if (c == '\n') m_line++;
+  }
+  return c;
+}
+
+void ListParser::skipSpace() {
+  int c = peekChar();
+  while (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+    (void)getChar();
+    c = peekChar();
+  }
+}
+
+bool ListParser::expect(char c) {
+  skipSpace();
+  return getChar() == c;
+}
+
+static void appendUtf8(std::string* pRes, uint32_t cp) {
+  if (cp < 0x80) {
+    pRes->push_back(cp);
+  } else if (cp < 0x800) {
+    pRes->push_back(0xc0 | (cp >> 6));
+    pRes->push_back(0x80 | (cp & 0x3f));
+  } else if (cp < 0x10000) {
+    pRes->push_back(0xe0 | (cp >> 12));
+    pRes->push_back(0x80 | ((cp >> 6) & 0x3f));
+    pRes->push_back(0x80 | (cp & 0x3f));
+  } else {
+    pRes->push_back(0xf0 | (cp >> 18));
+    pRes->push_back(0x80 | ((cp >> 12) & 0x3f));
+    pRes->push_back(0x80 | ((cp >> 6) & 0x3f));
+    pRes->push_back(0x80 | (cp & 0x3f));
+  }
+}
+
+bool ListParser::readHex4(uint32_t* pRes) {
+  *pRes = 0;
+  for (int i = 0; i < 4; i++) {
+    int c = getChar();
+    if (c >= '0' && c <= '9') *pRes = (*pRes << 4) | (c - '0');
+    else if (c >= 'a' && c <= 'f') *pRes = (*pRes << 4) | (c - 'a' + 10);
+    else if (c >= 'A' && c <= 'F') *pRes = (*pRes << 4) | (c - 'A' + 10);
+    else return false;
+  }
+  return true;
+}
+
+bool ListParser::readString(std::string* pRes) {
+  pRes->clear();
+  if (!expect('"')) {
+    return false;
+  }
+  while (true) {
+    int c = getChar();
+    if (c == -1 || c == '\n') return false;
+    if (c == '"') return true;
+    if (c != '\\') {
+      pRes->push_back(c);
+      continue;
+    }
+
+    c = getChar();
+    switch (c) {
+      case '"':  pRes->push_back('"');  break;
+      case '\\': pRes->push_back('\\'); break;
+      case '/':  pRes->push_back('/');  break;
+      case 'b':  pRes->push_back('\b'); break;
+      case 'f':  pRes->push_back('\f'); break;
+      case 'n':  pRes->push_back('\n'); break;
+      case 'r':  pRes->push_back('\r'); break;
+      case 't':  pRes->push_back('\t'); break;
+      case 'u': {
+        uint32_t cp;
+        if (!readHex4(&cp)) return false;
+        // high surrogate, the low one follows as its own escape
+        if (cp >= 0xd800 && cp < 0xdc00 && peekChar() == '\\') {
+          uint32_t low;
+          (void)getChar();
+          if (getChar() != 'u' || !readHex4(&low)) return false;
+          if (low >= 0xdc00 && low < 0xe000) {
+            cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+          } else {
+            appendUtf8(pRes, cp);
+            cp = low;
+          }
+        }
+        appendUtf8(pRes, cp);
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+}
+
+bool ListParser::readNumber(double* pRes) {
+  skipSpace();
+  std::string str;
+  int c = peekChar();
+  while (c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E' || (c >= '0' && c <= '9')) {
+    str.push_back(c);
+    (void)getChar();
+    c = peekChar();
+  }
+  char* end;
+  *pRes = strtod(str.c_str(), &end);
+  return !str.empty() && *end == '\0';
+}
+
+// format written by the scripts: "2016-01-31 23:59:59 +0000", the zone is optional
+bool ListParser::parseDate(const std::string& rStr, int64_t* pRes) {
+  struct tm tm;
+  memset(&tm, 0, sizeof(tm));
+  char sign = '+';
+  int zoneHours = 0, zoneMinutes = 0;
+  int n = sscanf(rStr.c_str(), "%4d-%2d-%2d %2d:%2d:%2d %c%2d%2d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+                 &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &sign, &zoneHours, &zoneMinutes);
+  if ((n != 6 && n != 9) || (sign != '+' && sign != '-') || tm.tm_mon < 1 || tm.tm_mon > 12 ||
+      tm.tm_mday < 1 || tm.tm_mday > 31 || tm.tm_hour > 23 || tm.tm_min > 59 || tm.tm_sec > 60) {
+    *pRes = 0;
+    return false;
+  }
+  tm.tm_year -= 1900;
+  tm.tm_mon -= 1;
+  int64_t offset = (zoneHours * 60 + zoneMinutes) * 60;
+  *pRes = (int64_t)timegm(&tm) - (sign == '-' ? -offset : offset);
+  return true;
+}
+
+// skips any value, nested objects and arrays are skipped by counting the brackets
+bool ListParser::skipValue() {
+  skipSpace();
+  int depth = 0;
+  std::string dummy;
+  do {
+    skipSpace();
+    int c = peekChar();
+    switch (c) {
+      case -1:
+        return false;
+      case '"':
+        if (!readString(&dummy)) return false;
+        break;
+      case '{':
+      case '[':
+        (void)getChar();
+        depth++;
+        break;
+      case '}':
+      case ']':
+        if (depth == 0) return false;
+        (void)getChar();
+        depth--;
+        break;
+      case ',':
+      case ':':
+        if (depth == 0) return false;
+        (void)getChar();
+        break;
+      default:
+        // number, true, false or null
+        if (!(c == '-' || c == '+' || c == '.' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) {
+          return false;
+        }
+        while (c == '-' || c == '+' || c == '.' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+          (void)getChar();
+          c = peekChar();
+        }
+        break;
+    }
+  } while (depth > 0);
+  return true;
+}
+
@@ -0,0 +1,82 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef LISTPARSER_H
+#define LISTPARSER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+
+
+#define LISTPARSER_BUFFER_SIZE  (64 * 1024)
+
+
+struct ListParserEntry {
+  std::string number;
+  std::string name;
+  int64_t dateCreated;    // seconds since the epoch, 0 when missing or invalid
+  int64_t dateModified;
+};
+
+// Streaming parser for list files:
+// { "name": "...", "max_age_days": N, "entries": [ { "number": "...", "name": "...",
+//   "date_created": "...", "date_modified": "..." }, ... ] }
+// The file is read through a fixed buffer and each entry is passed to the
+// callback as soon as it is complete, so no copy of the whole file or a
+// document tree is held in memory. Unknown members are skipped.
+class ListParser {
+public:
+  typedef std::function<void(const struct ListParserEntry& rEntry)> EntryCallback;
+
+private:
+  std::string m_filename;
+  int m_fd;
+  std::vector<char> m_buffer;
+  size_t m_pos;
+  size_t m_len;
+  int m_line;
+  int64_t m_maxAge;
+
+public:
+  ListParser();
+  virtual ~ListParser();
+
+  bool parse(const std::string& rFilename, std::string* pName, EntryCallback onEntry);
+  int64_t getMaxAge() const { return m_maxAge; }  // seconds, 0 when the list has none
+
+  static bool parseDate(const std::string& rStr, int64_t* pRes);
+
+private:
+  int peekChar();
+  int getChar();
+  void skipSpace();
+  bool expect(char c);
+  bool readHex4(uint32_t* pRes);
+  bool readString(std::string* pRes);
+  bool readNumber(double* pRes);
+  bool skipValue();
+  bool parseEntries(EntryCallback onEntry);
+  bool parseEntry(struct ListParserEntry* pEntry, bool* pComplete);
+  void close();
+};
+
+#endif
+
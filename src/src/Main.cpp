@@ -19,10 +19,15 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <signal.h>
 #include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
 
 #include "Logger.h"
+#include "EventLoop.h"
 #include "Settings.h"
 #include "FileLists.h"
 #include "SipPhone.h"
@@ -30,25 +35,15 @@
 #include "AnalogPhone.h"
 
 
-#define LOOP_WAIT_TIME_USEC    (50 * 1000)  // 50 miliseconds
-
-
-static bool s_appRunning = true;
-static bool s_appReloadConfig = false;
-
-static void signal_handler(int signal) {
-  if (signal == SIGHUP) {
-    s_appReloadConfig = true;
-    return;
-  }
-
-  Logger::info("exiting (signal %i received)...", signal);
-  s_appRunning = false;
-}
+#define HOUSEKEEPING_TIME_SEC   60   // e.g. compact lists with expired entries
 
 
 class Main {
 private:
+  EventLoop m_loop;
+  int m_signalFD;
+  int m_housekeepingFD;
+  bool m_running;
   Settings* m_pSettings;
   Block* m_pBlock;
   SipPhone* m_pSipPhone;
@@ -56,11 +51,33 @@ private:
   std::vector<AnalogPhone*> m_analogPhones;
 
 public:
-  Main() {
+  // rSignals: blocked in all threads, received by the main loop
+  Main(const sigset_t& rSignals) {
     Logger::start();
+    m_running = true;
+
+    m_signalFD = signalfd(-1, &rSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (m_signalFD < 0) {
+      Logger::warn("signalfd failed (%s)", strerror(errno));
+    }
+    (void)m_loop.add(m_signalFD, std::bind(&Main::onSignal, this));
+
+    m_housekeepingFD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = spec.it_interval.tv_sec = HOUSEKEEPING_TIME_SEC;
+    if (m_housekeepingFD < 0 || timerfd_settime(m_housekeepingFD, 0, &spec, NULL) < 0) {
+      Logger::warn("housekeeping timer failed (%s)", strerror(errno));
+    }
+    (void)m_loop.add(m_housekeepingFD, std::bind(&Main::onHousekeeping, this));
 
     m_pSettings = new Settings();
+    (void)m_loop.add(m_pSettings->getFD(), std::bind(&Main::onSettings, this));
     m_pBlock = new Block(m_pSettings);
+    std::vector<int> fds = m_pBlock->getFDs();
+    for(size_t i = 0; i < fds.size(); i++) {
+      (void)m_loop.add(fds[i], std::bind(&Block::run, m_pBlock));
+    }
 
     m_pSipPhone = NULL;
     add();
@@ -70,33 +87,57 @@ public:
     remove();
     delete m_pBlock;
     delete m_pSettings;
+    if (m_housekeepingFD >= 0) close(m_housekeepingFD);
+    if (m_signalFD >= 0) close(m_signalFD);
     Logger::stop();
   }
 
   void loop() {
     Logger::debug("enter main loop...");
-    while (s_appRunning) {
-      m_pBlock->run();
-
-      if (s_appReloadConfig || m_pSettings->hasChanged()) {
-        Logger::info("reload phones");
-        remove();
-        add();
-        s_appReloadConfig = false;
-      }
+    while (m_running) {
+      m_loop.run();
+    }
+  }
 
-      for(size_t i = 0; i < m_analogPhones.size(); i++) {
-        m_analogPhones[i]->run();
+private:
+  void onSignal() {
+    struct signalfd_siginfo info;
+    while (read(m_signalFD, &info, sizeof(info)) == sizeof(info)) {
+      if (info.ssi_signo == SIGHUP) {
+        reload();
+        continue;
       }
+      Logger::info("exiting (signal %i received)...", info.ssi_signo);
+      m_running = false;
+    }
+  }
+
+  void onHousekeeping() {
+    uint64_t expirations;
+    (void)read(m_housekeepingFD, &expirations, sizeof(expirations));
+    m_pBlock->run();
+  }
 
-      (void)usleep(LOOP_WAIT_TIME_USEC);
+  void onSettings() {
+    if (m_pSettings->hasChanged()) {
+      m_pBlock->reloadSettings();
+      reload();
     }
   }
 
-private:
+  void reload() {
+    Logger::info("reload phones");
+    remove();
+    add();
+  }
+
   void remove() {
     //  Analog
     for(size_t i = 0; i < m_analogPhones.size(); i++) {
+      std::vector<int> fds = m_analogPhones[i]->getFDs();
+      for(size_t j = 0; j < fds.size(); j++) {
+        m_loop.remove(fds[j]);
+      }
       delete m_analogPhones[i];
     }
     m_analogPhones.clear();
@@ -117,8 +158,15 @@ private:
     std::vector<struct SettingAnalogPhone> analogPhones = m_pSettings->getAnalogPhones();
     for(size_t i = 0; i < analogPhones.size(); i++) {
       AnalogPhone* tmp = new AnalogPhone(m_pBlock);
-      if (tmp->init(&analogPhones[i])) m_analogPhones.push_back(tmp);
-      else delete tmp;
+      if (!tmp->init(&analogPhones[i])) {
+        delete tmp;
+        continue;
+      }
+      m_analogPhones.push_back(tmp);
+      std::vector<int> fds = tmp->getFDs();
+      for(size_t j = 0; j < fds.size(); j++) {
+        (void)m_loop.add(fds[j], std::bind(&AnalogPhone::run, tmp));
+      }
     }
 
     // SIP
@@ -126,7 +174,7 @@ private:
     for(size_t i = 0; i < accounts.size(); i++) {
       if (m_pSipPhone == NULL) {
         m_pSipPhone = new SipPhone(m_pBlock);
-        if (!m_pSipPhone->init()) {
+        if (!m_pSipPhone->init(m_pSettings->getSipMaxCalls())) {
           break;
         }
       }
@@ -139,18 +187,18 @@ private:
 
 
 int main(int argc, char *argv[]) {
-	// register signal handler for break-in-keys (e.g. ctrl+c)
-	signal(SIGINT, signal_handler);
-	signal(SIGKILL, signal_handler);
-  // register signal handler for systemd shutdown request
-  signal(SIGTERM, signal_handler);
-  // register signal handler for systemd reload the configuration files request
-  signal(SIGHUP, signal_handler);
-
+  // break-in-keys (e.g. ctrl+c), systemd shutdown request and systemd reload the configuration files request
+  // are read by the main loop, they are blocked before any thread is started, so no other thread gets them
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGHUP);
+  sigprocmask(SIG_BLOCK, &signals, NULL);
 
   Logger::info("starting callblockerd %s", VERSION);
 
-  Main* m = new Main();
+  Main* m = new Main(signals);
   m->loop();
   delete m;
 
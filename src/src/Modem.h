@@ -35,6 +35,7 @@ public:
   virtual ~Modem();
 
   bool open(std::string name);
+  int getFD() { return m_FD; }
   bool sendCommand(std::string cmd);
   bool getData(std::string* data);
 };
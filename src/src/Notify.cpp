@@ -64,33 +64,53 @@ Notify::~Notify() {
 }
 
 bool Notify::hasChanged() {
+  std::vector<struct NotifyEvent> events;
+  return getEvents(&events);
+}
+
+bool Notify::getEvents(std::vector<struct NotifyEvent>* pEvents) {
+  pEvents->clear();
   if (m_WD < 0) {
     return false;
   }
 
-  bool res = false;
-  struct pollfd pfd = {m_FD, POLLIN | POLLPRI, 0};
-  int ret = poll(&pfd, 1, 0);
-  if (ret < 0) {
-    // Logger::warn("poll failed with %s", strerror(errno));
-    // also happens when application is shutdown...
-  } else if (ret == 0) {
-    // no event to read
-  } else {
+  while (true) {
+    struct pollfd pfd = {m_FD, POLLIN | POLLPRI, 0};
+    int ret = poll(&pfd, 1, 0);
+    if (ret < 0) {
+      // Logger::warn("poll failed with %s", strerror(errno));
+      // also happens when application is shutdown...
+      break;
+    } else if (ret == 0) {
+      // no (more) event to read
+      break;
+    }
+
     // event to read
-    char buffer[EVENT_BUF_LEN];
+    char buffer[EVENT_BUF_LEN] __attribute__ ((aligned(__alignof__(struct inotify_event))));
     int length = read(m_FD, buffer, sizeof(buffer));
+    if (length <= 0) {
+      break;
+    }
     int i = 0;
     while (i < length) {
       struct inotify_event *event = (struct inotify_event*)&buffer[i];
-      //Logger::debug("The file %s was touched", event->name);
       if (event->len) {
-        res = true;
-        break;
+        Logger::debug("The file %s was touched (0x%x)", event->name, event->mask);
+        struct NotifyEvent add;
+        add.name = event->name;
+        add.mask = event->mask;
+        pEvents->push_back(add);
+      } else if (event->mask & IN_Q_OVERFLOW) {
+        // events were dropped, it is unknown which files were touched
+        Logger::info("inotify event queue overflowed");
+        struct NotifyEvent add;
+        add.mask = IN_Q_OVERFLOW;
+        pEvents->push_back(add);
       }
       i += EVENT_SIZE + event->len;
     }
   }
-  return res;
+  return !pEvents->empty();
 }
 
@@ -21,9 +21,15 @@
 #define NOTIFY_H
 
 #include <string>
+#include <vector>
 #include <stdint.h>
 
 
+struct NotifyEvent {
+  std::string name;   // file name within the watched directory, empty for IN_Q_OVERFLOW
+  uint32_t mask;      // e.g. IN_CLOSE_WRITE, IN_DELETE, IN_MOVED_FROM, IN_MOVED_TO or IN_Q_OVERFLOW
+};
+
 class Notify {
 private:
   int m_FD;
@@ -32,7 +38,9 @@ private:
 public:
   Notify(const std::string& rPathname, uint32_t mask);
   virtual ~Notify();
+  int getFD() { return m_FD; }
   virtual bool hasChanged();
+  bool getEvents(std::vector<struct NotifyEvent>* pEvents);
 };
 
 #endif
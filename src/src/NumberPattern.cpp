@@ -0,0 +1,150 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "NumberPattern.h" // API
+
+#include <string>
+#include <vector>
+#include <string.h>
+
+
+bool NumberPattern::isWildcard(char c) {
+  return c == 'x' || c == 'X' || c == '?';
+}
+
+static bool isDigits(const std::string& rStr) {
+  if (rStr.empty()) return false;
+  for (size_t i = 0; i < rStr.length(); i++) {
+    if (rStr[i] < '0' || rStr[i] > '9') return false;
+  }
+  return true;
+}
+
+bool NumberPattern::isPattern(const char* pEntry) {
+  bool wildcard = false;
+  bool range = false;
+  for (const char* p = pEntry; *p != '\0'; p++) {
+    if (*p >= '0' && *p <= '9') continue;
+    if (*p == '+' && (p == pEntry || p[-1] == '-')) continue;
+    if (*p == '-' && !range) {
+      range = true;
+      continue;
+    }
+    if (isWildcard(*p)) {
+      wildcard = true;
+      continue;
+    }
+    return false;
+  }
+  // a range has no wildcards
+  return range != wildcard;
+}
+
+// pFrom, pTo: digits of the range ends with the same length, a leading '+' is removed
+bool NumberPattern::splitRange(const char* pEntry, std::string* pFrom, std::string* pTo) {
+  const char* sep = strchr(pEntry, '-');
+  if (sep == NULL) {
+    return false;
+  }
+  std::string from(pEntry, sep - pEntry);
+  std::string to(sep + 1);
+  bool plus = !from.empty() && from[0] == '+';
+  if (plus) from.erase(0, 1);
+  if (!to.empty() && to[0] == '+') {
+    if (!plus) return false;
+    to.erase(0, 1);
+    if (to.length() != from.length()) return false;
+  } else if (to.length() <= from.length()) {
+    to = from.substr(0, from.length() - to.length()) + to;
+  } else {
+    return false;
+  }
+  if (!isDigits(from) || !isDigits(to)) {
+    return false;
+  }
+  *pFrom = from;
+  *pTo = to;
+  return true;
+}
+
+// rFrom, rTo: digits of the same length, rFrom <= rTo
+void NumberPattern::compileRange(const std::string& rPrefix, const std::string& rFrom, const std::string& rTo,
+                                 std::vector<std::string>* pKeys) {
+  size_t len = rFrom.length();
+  if (rFrom == std::string(len, '0') && rTo == std::string(len, '9')) {
+    // also covers len == 0
+    pKeys->push_back(rPrefix + std::string(len, NUMBERPATTERN_WILDCARD));
+    return;
+  }
+  if (rFrom[0] == rTo[0]) {
+    compileRange(rPrefix + rFrom[0], rFrom.substr(1), rTo.substr(1), pKeys);
+    return;
+  }
+  // lower partial block, full blocks between, upper partial block
+  compileRange(rPrefix + rFrom[0], rFrom.substr(1), std::string(len - 1, '9'), pKeys);
+  for (char d = rFrom[0] + 1; d < rTo[0]; d++) {
+    pKeys->push_back(rPrefix + d + std::string(len - 1, NUMBERPATTERN_WILDCARD));
+  }
+  compileRange(rPrefix + rTo[0], std::string(len - 1, '0'), rTo.substr(1), pKeys);
+}
+
+// pKeys: keys for the NumberTrie, each wildcard as NUMBERPATTERN_WILDCARD
+bool NumberPattern::compile(const char* pEntry, std::vector<std::string>* pKeys) {
+  if (!isPattern(pEntry)) {
+    return false;
+  }
+
+  if (strchr(pEntry, '-') != NULL) {
+    std::string from, to;
+    if (!splitRange(pEntry, &from, &to) || from > to) {
+      return false;
+    }
+    compileRange(pEntry[0] == '+' ? "+" : "", from, to, pKeys);
+    return true;
+  }
+
+  std::string key(pEntry);
+  for (size_t i = 0; i < key.length(); i++) {
+    if (isWildcard(key[i])) key[i] = NUMBERPATTERN_WILDCARD;
+  }
+  pKeys->push_back(key);
+  return true;
+}
+
+// number of characters every number matching the entry starts with
+size_t NumberPattern::getLiteralPrefixLength(const char* pEntry) {
+  if (!isPattern(pEntry)) {
+    return strlen(pEntry);
+  }
+
+  if (strchr(pEntry, '-') != NULL) {
+    std::string from, to;
+    if (!splitRange(pEntry, &from, &to) || from > to) {
+      return strlen(pEntry); // no valid range, the entry is taken literally
+    }
+    size_t len = 0;
+    while (len < from.length() && from[len] == to[len]) len++;
+    return pEntry[0] == '+' ? len + 1 : len;
+  }
+
+  size_t len = 0;
+  while (!isWildcard(pEntry[len])) len++;
+  return len;
+}
+
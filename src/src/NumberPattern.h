@@ -0,0 +1,51 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef NUMBERPATTERN_H
+#define NUMBERPATTERN_H
+
+#include <string>
+#include <vector>
+
+
+#define NUMBERPATTERN_WILDCARD  'x'   // any single digit, in compiled keys
+
+
+// Patterns in list entries, besides plain numbers:
+// - wildcards: "+4179xxx12", each 'x' (or '?') stands for one digit
+// - ranges: "+41441234000-+41441234999" or short "+41441234000-4999",
+//   the end replaces the last digits of the start
+// Like a plain number, a pattern matches the start of the caller number.
+// A pattern is compiled into a few keys with wildcards, their number only
+// depends on the length of the pattern, not on the numbers it covers.
+class NumberPattern {
+public:
+  static bool isPattern(const char* pEntry);
+  static bool compile(const char* pEntry, std::vector<std::string>* pKeys);
+  static size_t getLiteralPrefixLength(const char* pEntry);
+
+private:
+  static bool isWildcard(char c);
+  static bool splitRange(const char* pEntry, std::string* pFrom, std::string* pTo);
+  static void compileRange(const std::string& rPrefix, const std::string& rFrom, const std::string& rTo,
+                           std::vector<std::string>* pKeys);
+};
+
+#endif
+
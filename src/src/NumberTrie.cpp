@@ -0,0 +1,354 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "NumberTrie.h" // API
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+
+#include "Logger.h"
+#include "NumberPattern.h"
+
+
+#define MAX_LABEL_LENGTH      255
+
+#define SYMBOL_WILDCARD       12
+
+
+NumberTrie::NumberTrie() {
+  m_pNodes = NULL;
+  m_numNodes = 0;
+  m_pLabels = NULL;
+  m_numLabels = 0;
+}
+
+NumberTrie::~NumberTrie() {
+  clear();
+}
+
+int NumberTrie::getSymbol(char c) {
+  if (c == NUMBERPATTERN_WILDCARD) return SYMBOL_WILDCARD;
+  return PackedNumber::getSymbol(c);
+}
+
+// plain numbers only, the keys of patterns come from NumberPattern::compile()
+bool NumberTrie::isIndexable(const char* pKey) {
+  size_t len = 0;
+  for (; *pKey != '\0'; pKey++, len++) {
+    if (PackedNumber::getSymbol(*pKey) < 0) return false;
+  }
+  return len <= NUMBERTRIE_MAX_KEY_LENGTH;
+}
+
+bool NumberTrie::isKey(const char* pKey, size_t* pLength) {
+  size_t len = 0;
+  for (; pKey[len] != '\0'; len++) {
+    if (getSymbol(pKey[len]) < 0) return false;
+  }
+  *pLength = len;
+  return len <= NUMBERTRIE_MAX_KEY_LENGTH;
+}
+
+void NumberTrie::clear() {
+  m_ownNodes.clear();
+  m_ownLabels.clear();
+  m_pNodes = NULL;
+  m_numNodes = 0;
+  m_pLabels = NULL;
+  m_numLabels = 0;
+}
+
+void NumberTrie::attach(const struct NumberTrieNode* pNodes, size_t numNodes, const uint64_t* pLabels, size_t numLabels) {
+  clear();
+  m_pNodes = pNodes;
+  m_numNodes = numNodes;
+  m_pLabels = pLabels;
+  m_numLabels = numLabels;
+}
+
+// checks that all indices of an attached tree stay within it, values must be below numValues
+bool NumberTrie::isValid(size_t numValues) const {
+  for (size_t i = 0; i < m_numNodes; i++) {
+    const struct NumberTrieNode* node = &m_pNodes[i];
+    if (i != 0 && node->labelLength == 0) {
+      return false; // a lookup would not advance
+    }
+    if (node->flags & NUMBERTRIE_LABEL_INLINE) {
+      if (node->labelLength > 8) return false;
+    } else {
+      size_t words = (node->labelLength + 15) / 16 * ((node->flags & NUMBERTRIE_LABEL_WILDCARD) ? 2 : 1);
+      if ((uint64_t)node->labelOffset + words > m_numLabels) return false;
+    }
+    if ((node->childMask >> (SYMBOL_WILDCARD + 1)) != 0) {
+      return false;
+    }
+    // children come after their parent, so there is no cycle
+    if (node->childMask != 0 &&
+        (node->firstChild <= i || (uint64_t)node->firstChild + __builtin_popcount(node->childMask) > m_numNodes)) {
+      return false;
+    }
+    if (node->flags & NUMBERTRIE_VALUES) {
+      if (node->value >= m_numLabels || m_pLabels[node->value] > m_numLabels - node->value - 1) return false;
+      for (uint64_t k = 1; k <= m_pLabels[node->value]; k++) {
+        if (m_pLabels[node->value + k] >= numValues) return false;
+      }
+    } else if (node->value != NUMBERTRIE_NO_VALUE && node->value >= numValues) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// rKeys: the keys must stay valid during the build only
+// rValues: value of each key, several keys may have the same value
+void NumberTrie::build(const std::vector<const char*>& rKeys, const std::vector<uint32_t>& rValues) {
+  clear();
+
+  // sort by symbols, so keys with the same prefix are adjacent and the children
+  // of a node are ordered by their first symbol; equal keys keep the lowest value first
+  std::vector<uint32_t> order;
+  std::vector<uint32_t> lengths(rKeys.size(), 0);
+  order.reserve(rKeys.size());
+  for (size_t i = 0; i < rKeys.size(); i++) {
+    size_t len;
+    if (isKey(rKeys[i], &len)) {
+      order.push_back(i);
+      lengths[i] = len;
+    }
+  }
+  std::sort(order.begin(), order.end(), [&rKeys, &rValues, &lengths](uint32_t a, uint32_t b) {
+    const char* ka = rKeys[a];
+    const char* kb = rKeys[b];
+    size_t len = std::min(lengths[a], lengths[b]);
+    for (size_t i = 0; i < len; i++) {
+      int sa = getSymbol(ka[i]);
+      int sb = getSymbol(kb[i]);
+      if (sa != sb) return sa < sb;
+    }
+    if (lengths[a] != lengths[b]) return lengths[a] < lengths[b];
+    return rValues[a] < rValues[b];
+  });
+
+  struct NumberTrieNode root = {0, 0, NUMBERTRIE_NO_VALUE, 0, 0, 0};
+  m_ownNodes.push_back(root);
+  buildNode(rKeys, rValues, lengths, order, 0, 0, order.size(), 0);
+
+  m_pNodes = &m_ownNodes[0];
+  m_numNodes = m_ownNodes.size();
+  m_pLabels = m_ownLabels.empty() ? NULL : &m_ownLabels[0];
+  m_numLabels = m_ownLabels.size();
+  Logger::debug("NumberTrie::build() %zu keys, %zu nodes, %zu label words",
+    order.size(), m_numNodes, m_numLabels);
+}
+
+// all keys in [lo, hi) share the first depth symbols, which end at node nodeIdx
+void NumberTrie::buildNode(const std::vector<const char*>& rKeys, const std::vector<uint32_t>& rValues, const std::vector<uint32_t>& rLengths,
+                           const std::vector<uint32_t>& rOrder, uint32_t nodeIdx, size_t lo, size_t hi, size_t depth) {
+  // keys ending here (sorted first, by value), the lowest value wins
+  std::vector<uint32_t> values;
+  while (lo < hi && rLengths[rOrder[lo]] == depth) {
+    if (values.empty() || values.back() != rValues[rOrder[lo]]) values.push_back(rValues[rOrder[lo]]);
+    lo++;
+  }
+  if (values.size() == 1) {
+    m_ownNodes[nodeIdx].value = values[0];
+  } else if (values.size() > 1) {
+    // equal keys of several entries, the others are needed when the lowest is not accepted
+    m_ownNodes[nodeIdx].value = m_ownLabels.size();
+    m_ownNodes[nodeIdx].flags |= NUMBERTRIE_VALUES;
+    m_ownLabels.push_back(values.size());
+    m_ownLabels.insert(m_ownLabels.end(), values.begin(), values.end());
+  }
+  if (lo == hi) {
+    return;
+  }
+
+  // one child per next symbol, its label is the common prefix of the group
+  std::vector<size_t> groupStart, groupEnd, groupDepth;
+  size_t i = lo;
+  while (i < hi) {
+    int symbol = getSymbol(rKeys[rOrder[i]][depth]);
+    size_t j = i + 1;
+    while (j < hi && getSymbol(rKeys[rOrder[j]][depth]) == symbol) j++;
+
+    const char* first = rKeys[rOrder[i]];
+    const char* last = rKeys[rOrder[j - 1]];
+    size_t end = depth + 1;
+    while (end < rLengths[rOrder[i]] && end < rLengths[rOrder[j - 1]] && first[end] == last[end] &&
+           end - depth < MAX_LABEL_LENGTH) {
+      end++;
+    }
+
+    struct NumberTrieNode child = {0, 0, NUMBERTRIE_NO_VALUE, 0, 0, 0};
+    addLabel(&child, first, depth, end);
+    if (groupStart.empty()) {
+      m_ownNodes[nodeIdx].firstChild = m_ownNodes.size();
+    }
+    m_ownNodes[nodeIdx].childMask |= 1 << symbol;
+    m_ownNodes.push_back(child);
+
+    groupStart.push_back(i);
+    groupEnd.push_back(j);
+    groupDepth.push_back(end);
+    i = j;
+  }
+
+  uint32_t firstChild = m_ownNodes[nodeIdx].firstChild;
+  for (size_t g = 0; g < groupStart.size(); g++) {
+    buildNode(rKeys, rValues, rLengths, rOrder, firstChild + g, groupStart[g], groupEnd[g], groupDepth[g]);
+  }
+}
+
+// packs the symbols [start, end) of pKey as label of pNode
+void NumberTrie::addLabel(struct NumberTrieNode* pNode, const char* pKey, size_t start, size_t end) {
+  size_t len = end - start;
+  bool wildcard = false;
+  for (size_t i = start; i < end; i++) {
+    if (getSymbol(pKey[i]) == SYMBOL_WILDCARD) wildcard = true;
+  }
+  pNode->labelLength = len;
+  pNode->flags &= ~(NUMBERTRIE_LABEL_INLINE | NUMBERTRIE_LABEL_WILDCARD);
+
+  if (len <= 8 && !wildcard) {
+    uint32_t inlineLabel = 0;
+    for (size_t i = 0; i < len; i++) {
+      inlineLabel |= (uint32_t)getSymbol(pKey[start + i]) << (28 - 4 * i);
+    }
+    pNode->labelOffset = inlineLabel;
+    pNode->flags |= NUMBERTRIE_LABEL_INLINE;
+    return;
+  }
+
+  pNode->labelOffset = m_ownLabels.size();
+  if (wildcard) pNode->flags |= NUMBERTRIE_LABEL_WILDCARD;
+  for (size_t chunk = 0; chunk < len; chunk += 16) {
+    uint64_t word = 0, care = 0;
+    for (size_t i = chunk; i < len && i < chunk + 16; i++) {
+      int symbol = getSymbol(pKey[start + i]);
+      size_t shift = 60 - 4 * (i - chunk);
+      word |= (uint64_t)symbol << shift;
+      if (symbol != SYMBOL_WILDCARD) care |= 0xfULL << shift;
+    }
+    m_ownLabels.push_back(word);
+    if (wildcard) m_ownLabels.push_back(care);
+  }
+}
+
+bool NumberTrie::find(const std::string& rNumber, uint32_t* pValue) const {
+  if (m_numNodes == 0) {
+    return false;
+  }
+
+  PackedNumber number(rNumber);
+  uint32_t best = NUMBERTRIE_NO_VALUE;
+  findFrom(&m_pNodes[0], number, 0, NULL, &best);
+  if (best == NUMBERTRIE_NO_VALUE) {
+    return false;
+  }
+  *pValue = best;
+  return true;
+}
+
+// the lowest value of all matching keys, which rAccept takes
+bool NumberTrie::find(const std::string& rNumber, uint32_t* pValue, const AcceptFunc& rAccept) const {
+  if (m_numNodes == 0) {
+    return false;
+  }
+
+  PackedNumber number(rNumber);
+  uint32_t best = NUMBERTRIE_NO_VALUE;
+  findFrom(&m_pNodes[0], number, 0, &rAccept, &best);
+  if (best == NUMBERTRIE_NO_VALUE) {
+    return false;
+  }
+  *pValue = best;
+  return true;
+}
+
+// walks the exact path from pNode, a wildcard branch on the way is searched recursively
+// pAccept: NULL to take every key
+void NumberTrie::findFrom(const struct NumberTrieNode* pNode, const PackedNumber& rNumber, size_t pos,
+                          const AcceptFunc* pAccept, uint32_t* pBest) const {
+  const struct NumberTrieNode* node = pNode;
+  uint32_t value = getValue(node, pAccept);
+  if (value < *pBest) *pBest = value;
+  while (pos < rNumber.getLength()) {
+    int symbol = rNumber.getSymbol(pos);
+    if (symbol <= 9 && (node->childMask & (1 << SYMBOL_WILDCARD)) != 0) {
+      const struct NumberTrieNode* wildcard = &m_pNodes[node->firstChild + __builtin_popcount(node->childMask & ((1 << SYMBOL_WILDCARD) - 1))];
+      if (matchLabel(wildcard, rNumber, pos)) {
+        findFrom(wildcard, rNumber, pos + wildcard->labelLength, pAccept, pBest);
+      }
+    }
+    if ((node->childMask & (1 << symbol)) == 0) {
+      break;
+    }
+    const struct NumberTrieNode* child = &m_pNodes[node->firstChild + __builtin_popcount(node->childMask & ((1 << symbol) - 1))];
+    if (!matchLabel(child, rNumber, pos)) {
+      break;
+    }
+    pos += child->labelLength;
+    value = getValue(child, pAccept);
+    if (value < *pBest) *pBest = value;
+    node = child;
+  }
+}
+
+// the lowest value of the keys ending at pNode, which pAccept takes
+uint32_t NumberTrie::getValue(const struct NumberTrieNode* pNode, const AcceptFunc* pAccept) const {
+  if ((pNode->flags & NUMBERTRIE_VALUES) == 0) {
+    if (pNode->value == NUMBERTRIE_NO_VALUE || pAccept == NULL || (*pAccept)(pNode->value)) {
+      return pNode->value;
+    }
+    return NUMBERTRIE_NO_VALUE;
+  }
+  const uint64_t* values = &m_pLabels[pNode->value];
+  for (uint64_t i = 1; i <= values[0]; i++) {
+    if (pAccept == NULL || (*pAccept)(values[i])) return values[i];
+  }
+  return NUMBERTRIE_NO_VALUE;
+}
+
+// compares up to 16 symbols at once, a wildcard in the label matches any digit
+bool NumberTrie::matchLabel(const struct NumberTrieNode* pNode, const PackedNumber& rNumber, size_t pos) const {
+  size_t len = pNode->labelLength;
+  if (pos + len > rNumber.getLength()) {
+    return false;
+  }
+  if (pNode->flags & NUMBERTRIE_LABEL_INLINE) {
+    return ((rNumber.get(pos) ^ ((uint64_t)pNode->labelOffset << 32)) & PackedNumber::getMask(len)) == 0;
+  }
+
+  const uint64_t* label = &m_pLabels[pNode->labelOffset];
+  bool wildcard = (pNode->flags & NUMBERTRIE_LABEL_WILDCARD) != 0;
+  for (size_t chunk = 0; chunk < len; chunk += 16) {
+    uint64_t mask = PackedNumber::getMask(len - chunk);
+    if (wildcard) {
+      uint64_t care = label[1];
+      if ((rNumber.getNonDigits(pos + chunk) & mask & ~care) != 0) return false; // wildcard on no digit
+      mask &= care;
+    }
+    if (((rNumber.get(pos + chunk) ^ label[0]) & mask) != 0) return false;
+    label += wildcard ? 2 : 1;
+  }
+  return true;
+}
+
@@ -0,0 +1,102 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef NUMBERTRIE_H
+#define NUMBERTRIE_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+
+#include "PackedNumber.h"
+
+
+#define NUMBERTRIE_NO_VALUE         0xffffffff
+#define NUMBERTRIE_MAX_KEY_LENGTH   PACKEDNUMBER_MAX_LENGTH
+
+#define NUMBERTRIE_LABEL_INLINE     0x01  // label of up to 8 symbols, packed into labelOffset
+#define NUMBERTRIE_LABEL_WILDCARD   0x02  // each label word is followed by its mask of non wildcard symbols
+#define NUMBERTRIE_VALUES           0x04  // several keys end here, value is the offset of their count and values in the label words
+
+
+// fixed layout, it is stored as is in the list index file (see ListIndex)
+struct NumberTrieNode {
+  uint32_t labelOffset;   // packed symbols of the edge leading to this node, in the label words
+  uint32_t firstChild;    // children are stored consecutive
+  uint32_t value;         // NUMBERTRIE_NO_VALUE, when no key ends here (see NUMBERTRIE_VALUES)
+  uint16_t childMask;     // bit n is set, when a child starting with symbol n exists
+  uint8_t labelLength;
+  uint8_t flags;          // NUMBERTRIE_LABEL_*
+};
+
+// Radix tree over the symbols '0'-'9', '+', '*' and the wildcard 'x' (any digit,
+// see NumberPattern). Each key has a value, a lookup returns the lowest value of
+// all keys matching the start of the given number. At a node with a wildcard
+// child both the exact and the wildcard branch are followed.
+// Labels are stored packed like a PackedNumber, so matching a label against the
+// looked up number is a mask and compare of up to 16 symbols at once.
+// The tree is either built (and owned) or attached to external memory.
+class NumberTrie {
+public:
+  // decides if the key with the value is taken, otherwise the next best match is searched
+  typedef std::function<bool(uint32_t value)> AcceptFunc;
+
+private:
+  std::vector<struct NumberTrieNode> m_ownNodes;
+  std::vector<uint64_t> m_ownLabels;
+
+  const struct NumberTrieNode* m_pNodes;
+  size_t m_numNodes;
+  const uint64_t* m_pLabels;
+  size_t m_numLabels;
+
+public:
+  NumberTrie();
+  virtual ~NumberTrie();
+
+  void build(const std::vector<const char*>& rKeys, const std::vector<uint32_t>& rValues);
+  void attach(const struct NumberTrieNode* pNodes, size_t numNodes, const uint64_t* pLabels, size_t numLabels);
+  void clear();
+  bool find(const std::string& rNumber, uint32_t* pValue) const;
+  bool find(const std::string& rNumber, uint32_t* pValue, const AcceptFunc& rAccept) const;
+
+  const struct NumberTrieNode* getNodes() const { return m_pNodes; }
+  size_t getNumNodes() const { return m_numNodes; }
+  const uint64_t* getLabels() const { return m_pLabels; }
+  size_t getNumLabels() const { return m_numLabels; }  // in words
+
+  bool isValid(size_t numValues) const;
+
+  static bool isIndexable(const char* pKey);
+
+private:
+  static int getSymbol(char c);
+  static bool isKey(const char* pKey, size_t* pLength);
+  void buildNode(const std::vector<const char*>& rKeys, const std::vector<uint32_t>& rValues, const std::vector<uint32_t>& rLengths,
+                 const std::vector<uint32_t>& rOrder, uint32_t nodeIdx, size_t lo, size_t hi, size_t depth);
+  void addLabel(struct NumberTrieNode* pNode, const char* pKey, size_t start, size_t end);
+  void findFrom(const struct NumberTrieNode* pNode, const PackedNumber& rNumber, size_t pos,
+                const AcceptFunc* pAccept, uint32_t* pBest) const;
+  uint32_t getValue(const struct NumberTrieNode* pNode, const AcceptFunc* pAccept) const;
+  bool matchLabel(const struct NumberTrieNode* pNode, const PackedNumber& rNumber, size_t pos) const;
+};
+
+#endif
+
@@ -0,0 +1,199 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "OnlineCache.h" // API
+
+#include <string>
+#include <fstream>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "Logger.h"
+
+
+OnlineCache::OnlineCache(const std::string& rFilename) {
+  Logger::debug("OnlineCache::OnlineCache()...");
+  m_filename = rFilename;
+  m_hits = 0;
+  m_misses = 0;
+  m_reportedLookups = 0;
+  m_dirty = false;
+  load();
+}
+
+OnlineCache::~OnlineCache() {
+  Logger::debug("OnlineCache::~OnlineCache()...");
+  run();
+}
+
+std::string OnlineCache::getKey(const std::string& rScript, const std::string& rNumber) {
+  return rScript + " " + rNumber;
+}
+
+bool OnlineCache::get(const std::string& rScript, const std::string& rNumber, std::string* pResult) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::unordered_map<std::string, struct OnlineCacheEntry>::iterator it = m_entries.find(getKey(rScript, rNumber));
+  bool hit = false;
+  if (it != m_entries.end()) {
+    if (it->second.expires > time(NULL)) {
+      hit = true;
+      *pResult = it->second.result;
+    } else {
+      // the others are removed by run()
+      m_entries.erase(it);
+      m_dirty = true;
+    }
+  }
+  if (hit) {
+    m_hits++;
+  } else {
+    m_misses++;
+  }
+  Logger::debug("online cache %s for %s of %s", hit ? "hit" : "miss", rNumber.c_str(), rScript.c_str());
+  return hit;
+}
+
+// ttl: seconds the result is valid, 0 does not cache it
+void OnlineCache::put(const std::string& rScript, const std::string& rNumber, const std::string& rResult, unsigned int ttl) {
+  if (ttl == 0 || rScript.find_first_of(" \t\n") != std::string::npos || rNumber.find_first_of("\t\n") != std::string::npos) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  struct OnlineCacheEntry entry;
+  entry.expires = time(NULL) + ttl;
+  entry.result = rResult;
+  // one line per entry, the whitespace of the JSON result is not needed
+  for(size_t i = 0; i < entry.result.length(); i++) {
+    if (entry.result[i] == '\n' || entry.result[i] == '\r' || entry.result[i] == '\t') entry.result[i] = ' ';
+  }
+  m_entries[getKey(rScript, rNumber)] = entry;
+  m_dirty = true;
+}
+
+// called periodically, writes the changes and reports the hit rate
+void OnlineCache::run() {
+  std::string data;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_hits + m_misses != m_reportedLookups) {
+      m_reportedLookups = m_hits + m_misses;
+      Logger::info("online cache: %llu hits, %llu misses, %.0f%% hit rate", (unsigned long long)m_hits,
+        (unsigned long long)m_misses, 100.0 * m_hits / m_reportedLookups);
+    }
+    if (removeExpired(time(NULL))) {
+      m_dirty = true;
+    }
+    if (!m_dirty) {
+      return;
+    }
+    std::unordered_map<std::string, struct OnlineCacheEntry>::const_iterator it;
+    for(it = m_entries.begin(); it != m_entries.end(); ++it) {
+      data += std::to_string(it->second.expires) + '\t' + it->first + '\t' + it->second.result + '\n';
+    }
+    m_dirty = false;
+  }
+
+  // lookups are not blocked by writing the file
+  if (!save(data)) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_dirty = true;
+  }
+}
+
+// returns true, if any entry was removed
+bool OnlineCache::removeExpired(int64_t now) {
+  bool removed = false;
+  std::unordered_map<std::string, struct OnlineCacheEntry>::iterator it = m_entries.begin();
+  while (it != m_entries.end()) {
+    if (it->second.expires <= now) {
+      it = m_entries.erase(it);
+      removed = true;
+    } else {
+      ++it;
+    }
+  }
+  return removed;
+}
+
+// file format: one line per entry "<expires>\t<script> <number>\t<result>"
+void OnlineCache::load() {
+  std::ifstream in(m_filename.c_str());
+  if (in.fail()) {
+    Logger::debug("no online cache %s", m_filename.c_str());
+    return;
+  }
+
+  int64_t now = time(NULL);
+  std::string line;
+  size_t invalid = 0;
+  while (std::getline(in, line)) {
+    size_t tab1 = line.find('\t');
+    size_t tab2 = tab1 == std::string::npos ? std::string::npos : line.find('\t', tab1 + 1);
+    if (tab2 == std::string::npos) {
+      invalid++;
+      continue;
+    }
+    struct OnlineCacheEntry entry;
+    char* end;
+    entry.expires = strtoll(line.c_str(), &end, 10);
+    if (end != line.c_str() + tab1) {
+      invalid++;
+      continue;
+    }
+    if (entry.expires <= now) {
+      continue;
+    }
+    entry.result = line.substr(tab2 + 1);
+    m_entries[line.substr(tab1 + 1, tab2 - tab1 - 1)] = entry;
+  }
+  if (invalid != 0) {
+    Logger::warn("ignored %zu invalid lines in online cache %s", invalid, m_filename.c_str());
+  }
+  Logger::debug("loaded %zu entries of online cache %s", m_entries.size(), m_filename.c_str());
+}
+
+bool OnlineCache::save(const std::string& rData) {
+  std::string dirname = m_filename.substr(0, m_filename.rfind('/'));
+  if (mkdir(dirname.c_str(), 0755) != 0 && errno != EEXIST) {
+    Logger::warn("create directory %s failed (%s)", dirname.c_str(), strerror(errno));
+    return false;
+  }
+
+  // replace atomically, so a crash leaves the old or the new version
+  std::string tmpFilename = m_filename + ".tmp";
+  std::ofstream out(tmpFilename.c_str(), std::ios::trunc);
+  out << rData;
+  out.close();
+  if (out.fail()) {
+    Logger::warn("writing online cache %s failed", tmpFilename.c_str());
+    (void)unlink(tmpFilename.c_str());
+    return false;
+  }
+  if (rename(tmpFilename.c_str(), m_filename.c_str()) != 0) {
+    Logger::warn("rename %s failed (%s)", tmpFilename.c_str(), strerror(errno));
+    (void)unlink(tmpFilename.c_str());
+    return false;
+  }
+  return true;
+}
+
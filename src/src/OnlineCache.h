@@ -0,0 +1,64 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef ONLINECACHE_H
+#define ONLINECACHE_H
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <stdint.h>
+
+
+struct OnlineCacheEntry {
+  int64_t expires;          // seconds since the epoch
+  std::string result;       // output of the script
+};
+
+// Results of the online check and lookup scripts, by script and number.
+// Each result is kept for the time to live given when it is added, so a
+// repeated caller does not run the script again. Changes are written to its
+// file by run() and when the cache is destroyed, so it survives a restart.
+class OnlineCache {
+private:
+  std::string m_filename;
+  std::mutex m_mutex;
+  std::unordered_map<std::string, struct OnlineCacheEntry> m_entries;
+  uint64_t m_hits;
+  uint64_t m_misses;
+  uint64_t m_reportedLookups;
+  bool m_dirty;
+
+public:
+  OnlineCache(const std::string& rFilename);
+  virtual ~OnlineCache();
+
+  bool get(const std::string& rScript, const std::string& rNumber, std::string* pResult);
+  void put(const std::string& rScript, const std::string& rNumber, const std::string& rResult, unsigned int ttl);
+  void run();
+
+private:
+  void load();
+  bool save(const std::string& rData);
+  bool removeExpired(int64_t now);
+  static std::string getKey(const std::string& rScript, const std::string& rNumber);
+};
+
+#endif
+
@@ -0,0 +1,109 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "OnlinePlugin.h" // API
+
+#include <string>
+#include <vector>
+#include <dlfcn.h>
+
+#include "Logger.h"
+#include "Helper.h"
+
+
+OnlinePlugin::OnlinePlugin(const std::string& rFilename) {
+  Logger::debug("OnlinePlugin::OnlinePlugin(%s)...", rFilename.c_str());
+  m_filename = rFilename;
+  m_handle = NULL;
+  m_pPlugin = NULL;
+}
+
+OnlinePlugin::~OnlinePlugin() {
+  Logger::debug("OnlinePlugin::~OnlinePlugin(%s)...", m_filename.c_str());
+  if (m_handle != NULL) {
+    dlclose(m_handle);
+    m_handle = NULL;
+  }
+}
+
+bool OnlinePlugin::load() {
+  m_handle = dlopen(m_filename.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (m_handle == NULL) {
+    Logger::warn("loading plugin %s failed (%s)", m_filename.c_str(), dlerror());
+    return false;
+  }
+  callblocker_plugin_init_func init = (callblocker_plugin_init_func)dlsym(m_handle, CALLBLOCKER_PLUGIN_INIT);
+  if (init == NULL) {
+    Logger::warn("plugin %s has no %s", m_filename.c_str(), CALLBLOCKER_PLUGIN_INIT);
+    return false;
+  }
+  m_pPlugin = init();
+  if (m_pPlugin == NULL || m_pPlugin->check == NULL) {
+    Logger::warn("plugin %s failed to initialize", m_filename.c_str());
+    m_pPlugin = NULL;
+    return false;
+  }
+  if (m_pPlugin->api_version != CALLBLOCKER_PLUGIN_API_VERSION) {
+    Logger::warn("plugin %s has api version %d, expected %d", m_filename.c_str(), m_pPlugin->api_version,
+      CALLBLOCKER_PLUGIN_API_VERSION);
+    m_pPlugin = NULL;
+    return false;
+  }
+  Logger::info("loaded plugin %s", m_filename.c_str());
+  return true;
+}
+
+// rCredentials: key, value, ... pairs
+bool OnlinePlugin::check(const std::string& rNumber, const std::vector<std::string>& rCredentials,
+                         const OnlinePluginDone& rDone) {
+  if (m_pPlugin == NULL) {
+    return false;
+  }
+  std::vector<const char*> credentials;
+  for(size_t i = 0; i < rCredentials.size(); i++) {
+    credentials.push_back(rCredentials[i].c_str());
+  }
+  credentials.push_back(NULL);
+
+  OnlinePluginDone* pDone = new OnlinePluginDone(rDone); // freed by onResult
+  if (!m_pPlugin->check(rNumber.c_str(), &credentials[0], onResult, pDone)) {
+    Logger::warn("plugin %s failed to check %s", m_filename.c_str(), rNumber.c_str());
+    delete pDone;
+    return false;
+  }
+  return true;
+}
+
+void OnlinePlugin::onResult(void* context, int ok, int spam, int score, const char* name) {
+  OnlinePluginDone* pDone = (OnlinePluginDone*)context;
+  std::string res;
+  if (ok) {
+    res = std::string("{\"spam\": ") + (spam ? "true" : "false");
+    if (score >= 0) {
+      res += ", \"score\": " + std::to_string(score);
+    }
+    if (name != NULL && name[0] != '\0') {
+      res += ", \"name\": \"" + Helper::escapeJsonString(name) + "\"";
+    }
+    res += "}";
+  }
+  (*pDone)(ok != 0, res);
+  delete pDone;
+}
+
@@ -0,0 +1,53 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef ONLINEPLUGIN_H
+#define ONLINEPLUGIN_H
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "OnlinePluginApi.h"
+
+
+// result of a check, as JSON like printed by the online scripts
+typedef std::function<void(bool ok, const std::string& rRes)> OnlinePluginDone;
+
+// An online check or lookup plugin (see OnlinePluginApi.h), loaded from a
+// shared library. It runs in-process, without starting a script.
+class OnlinePlugin {
+private:
+  std::string m_filename;
+  void* m_handle;
+  const struct callblocker_plugin* m_pPlugin;
+
+public:
+  OnlinePlugin(const std::string& rFilename);
+  virtual ~OnlinePlugin();
+
+  bool load();
+  bool check(const std::string& rNumber, const std::vector<std::string>& rCredentials, const OnlinePluginDone& rDone);
+
+private:
+  static void onResult(void* context, int ok, int spam, int score, const char* name);
+};
+
+#endif
+
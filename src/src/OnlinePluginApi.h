@@ -0,0 +1,67 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef ONLINEPLUGINAPI_H
+#define ONLINEPLUGINAPI_H
+
+/*
+ Interface of the online check and lookup plugins, loaded by callblockerd
+ from its plugins directory. A plugin is a shared library named like the
+ script it replaces, e.g. onlinecheck_<name>.so instead of
+ onlinecheck_<name>.py, exporting callblocker_plugin_init(). It is plain C,
+ so a plugin does not depend on the compiler of the daemon.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CALLBLOCKER_PLUGIN_API_VERSION  1
+#define CALLBLOCKER_PLUGIN_INIT         "callblocker_plugin_init"
+
+/*
+ Result of a check, may be called from any thread, but exactly once per check.
+ ok:    0 if the check failed, the other values are ignored then
+ spam:  1 if the number is known as spam
+ score: -1 if unknown
+ name:  name of the caller, NULL or "" if unknown, only valid during the call
+*/
+typedef void (*callblocker_plugin_result)(void* context, int ok, int spam, int score, const char* name);
+
+struct callblocker_plugin {
+  int api_version;  /* CALLBLOCKER_PLUGIN_API_VERSION */
+
+  /*
+   Starts the check of a number and returns at once, the result is reported
+   by calling result(context, ...).
+   credentials: "key", "value", ... pairs of the online credentials, terminated by NULL
+   returns 0 if the check could not be started, result is not called then
+  */
+  int (*check)(const char* number, const char* const* credentials, callblocker_plugin_result result, void* context);
+};
+
+/* returns NULL if the plugin can not be used */
+typedef const struct callblocker_plugin* (*callblocker_plugin_init_func)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -0,0 +1,66 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "PackedNumber.h" // API
+
+#include <string>
+#include <string.h>
+
+
+PackedNumber::PackedNumber(const std::string& rNumber) {
+  pack(rNumber.c_str());
+}
+
+PackedNumber::PackedNumber(const char* pNumber) {
+  pack(pNumber);
+}
+
+int PackedNumber::getSymbol(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c == '+') return PACKEDNUMBER_SYMBOL_PLUS;
+  if (c == '*') return PACKEDNUMBER_SYMBOL_STAR;
+  return -1;
+}
+
+void PackedNumber::pack(const char* pNumber) {
+  memset(m_words, 0, sizeof(m_words));
+  memset(m_nonDigits, 0, sizeof(m_nonDigits));
+  m_length = 0;
+  while (m_length < PACKEDNUMBER_MAX_LENGTH) {
+    int symbol = getSymbol(pNumber[m_length]);
+    if (symbol < 0) break;
+    size_t shift = 60 - 4 * (m_length % 16);
+    m_words[m_length / 16] |= (uint64_t)symbol << shift;
+    if (symbol > 9) m_nonDigits[m_length / 16] |= 0xfULL << shift;
+    m_length++;
+  }
+}
+
+bool PackedNumber::startsWith(const PackedNumber& rPrefix) const {
+  if (rPrefix.m_length > m_length) {
+    return false;
+  }
+  for (size_t pos = 0; pos < rPrefix.m_length; pos += 16) {
+    if ((m_words[pos / 16] ^ rPrefix.m_words[pos / 16]) & getMask(rPrefix.m_length - pos)) {
+      return false;
+    }
+  }
+  return true;
+}
+
@@ -0,0 +1,72 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef PACKEDNUMBER_H
+#define PACKEDNUMBER_H
+
+#include <string>
+#include <stdint.h>
+
+
+#define PACKEDNUMBER_SYMBOLS_PER_WORD  16
+#define PACKEDNUMBER_MAX_LENGTH        64
+// one more word, so reading 16 symbols never crosses the end
+#define PACKEDNUMBER_WORDS             (PACKEDNUMBER_MAX_LENGTH / PACKEDNUMBER_SYMBOLS_PER_WORD + 1)
+
+#define PACKEDNUMBER_SYMBOL_PLUS       10
+#define PACKEDNUMBER_SYMBOL_STAR       11
+
+
+// Number packed as 4 bit symbols ('0'-'9' as BCD, '+' and '*'), 16 symbols per
+// 64 bit word and the first symbol in the highest bits. An E.164 number ('+'
+// and up to 15 digits) fits into one word, so checking if it starts with a
+// packed prefix is a single mask and compare.
+// Packing stops at the first character without a symbol.
+class PackedNumber {
+private:
+  uint64_t m_words[PACKEDNUMBER_WORDS];
+  uint64_t m_nonDigits[PACKEDNUMBER_WORDS];  // symbol bits set to 0xf, where it is no digit
+  size_t m_length;
+
+public:
+  PackedNumber(const std::string& rNumber);
+  PackedNumber(const char* pNumber);
+
+  size_t getLength() const { return m_length; }
+  int getSymbol(size_t pos) const { return (m_words[pos / 16] >> (60 - 4 * (pos % 16))) & 0xf; }
+  uint64_t get(size_t pos) const { return read(m_words, pos); }
+  uint64_t getNonDigits(size_t pos) const { return read(m_nonDigits, pos); }
+  bool startsWith(const PackedNumber& rPrefix) const;
+
+  // mask of the first count symbols of a word
+  static uint64_t getMask(size_t count) { return count >= 16 ? ~0ULL : ~(~0ULL >> (4 * count)); }
+  static int getSymbol(char c);
+
+private:
+  void pack(const char* pNumber);
+  // 16 symbols starting at pos, the first in the highest bits
+  static uint64_t read(const uint64_t* pWords, size_t pos) {
+    size_t shift = 4 * (pos % 16);
+    uint64_t w = pWords[pos / 16] << shift;
+    return shift == 0 ? w : w | (pWords[pos / 16 + 1] >> (64 - shift));
+  }
+};
+
+#endif
+
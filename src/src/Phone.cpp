@@ -32,11 +32,12 @@ Phone::~Phone() {
   m_pBlock = NULL;
 }
 
-bool Phone::isNumberBlocked(const struct SettingBase* pSettings, const std::string& rNumber, std::string* pMsg) {
-  return m_pBlock->isNumberBlocked(pSettings, rNumber, pMsg);
+bool Phone::isNumberBlocked(const struct SettingBase* pSettings, const std::string& rNumber, const std::atomic<bool>* pStop,
+                            std::string* pMsg) {
+  return m_pBlock->isNumberBlocked(pSettings, rNumber, pStop, pMsg);
 }
 
-bool Phone::isAnonymousNumberBlocked(const struct SettingBase* pSettings, std::string* pMsg) {
-  return m_pBlock->isAnonymousNumberBlocked(pSettings, pMsg);
+bool Phone::isAnonymousNumberBlocked(const struct SettingBase* pSettings, const std::atomic<bool>* pStop, std::string* pMsg) {
+  return m_pBlock->isAnonymousNumberBlocked(pSettings, pStop, pMsg);
 }
 
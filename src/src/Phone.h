@@ -34,8 +34,9 @@ public:
   Phone(Block* pBlock);
   virtual ~Phone();
 
-  bool isNumberBlocked(const struct SettingBase* pSettings, const std::string& rNumber, std::string* pMsg);
-  bool isAnonymousNumberBlocked(const struct SettingBase* pSettings, std::string* pMsg);
+  bool isNumberBlocked(const struct SettingBase* pSettings, const std::string& rNumber, const std::atomic<bool>* pStop,
+                       std::string* pMsg);
+  bool isAnonymousNumberBlocked(const struct SettingBase* pSettings, const std::atomic<bool>* pStop, std::string* pMsg);
 };
 
 #endif
@@ -0,0 +1,141 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "PrefixFilter.h" // API
+
+#include <string>
+#include <vector>
+#include <math.h>
+
+#include "Logger.h"
+
+
+#define FNV_OFFSET_BASIS    0xcbf29ce484222325ULL
+#define FNV_PRIME           0x100000001b3ULL
+
+#define MIN_FP_RATE         0.000001
+#define MAX_HASHES          16
+
+
+PrefixFilter::PrefixFilter() {
+}
+
+PrefixFilter::~PrefixFilter() {
+  clear();
+}
+
+void PrefixFilter::clear() {
+  m_levels.clear();
+}
+
+// finalizer of splitmix64, spreads the FNV hash over all bits
+uint64_t PrefixFilter::mix(uint64_t hash) {
+  hash ^= hash >> 30;
+  hash *= 0xbf58476d1ce4e5b9ULL;
+  hash ^= hash >> 27;
+  hash *= 0x94d049bb133111ebULL;
+  hash ^= hash >> 31;
+  return hash;
+}
+
+// rLengths: only the first rLengths[i] characters of rKeys[i] are used
+// fpRate: wanted false positive rate of a whole lookup, it is split over the levels
+void PrefixFilter::build(const std::vector<const char*>& rKeys, const std::vector<size_t>& rLengths, double fpRate) {
+  clear();
+  if (fpRate < MIN_FP_RATE) fpRate = MIN_FP_RATE;
+
+  std::vector<size_t> counts;
+  for (size_t i = 0; i < rKeys.size(); i++) {
+    if (rLengths[i] >= counts.size()) counts.resize(rLengths[i] + 1, 0);
+    counts[rLengths[i]]++;
+  }
+
+  std::vector<size_t> levelByLength(counts.size(), 0);
+  size_t numLevels = 0;
+  for (size_t len = 0; len < counts.size(); len++) {
+    if (counts[len] != 0) numLevels++;
+  }
+  double levelFpRate = fpRate / (numLevels != 0 ? numLevels : 1);
+  for (size_t len = 0; len < counts.size(); len++) {
+    if (counts[len] == 0) continue;
+    // optimal size and number of hashes: m = -n ln(p) / ln(2)^2, k = m/n ln(2)
+    struct PrefixFilterLevel level;
+    level.length = len;
+    level.numBits = (uint64_t)ceil(-(double)counts[len] * log(levelFpRate) / (M_LN2 * M_LN2));
+    if (level.numBits < 64) level.numBits = 64;
+    level.numHashes = (uint32_t)round((double)level.numBits / counts[len] * M_LN2);
+    if (level.numHashes < 1) level.numHashes = 1;
+    if (level.numHashes > MAX_HASHES) level.numHashes = MAX_HASHES;
+    level.bits.assign((level.numBits + 63) / 64, 0);
+    levelByLength[len] = m_levels.size();
+    m_levels.push_back(level);
+  }
+
+  for (size_t i = 0; i < rKeys.size(); i++) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (size_t j = 0; j < rLengths[i]; j++) {
+      hash = (hash ^ (uint8_t)rKeys[i][j]) * FNV_PRIME;
+    }
+    struct PrefixFilterLevel* level = &m_levels[levelByLength[rLengths[i]]];
+    uint64_t h = mix(hash);
+    uint64_t h1 = h & 0xffffffff, h2 = (h >> 32) | 1;
+    for (uint32_t k = 0; k < level->numHashes; k++) {
+      uint64_t bit = (h1 + k * h2) % level->numBits;
+      level->bits[bit / 64] |= 1ULL << (bit % 64);
+    }
+  }
+
+  Logger::debug("PrefixFilter::build() %zu keys, %zu levels, %zu bytes", rKeys.size(), m_levels.size(), getSize());
+}
+
+bool PrefixFilter::mayContainPrefixOf(const std::string& rNumber) const {
+  // the hash of each prefix is the running hash over the number
+  uint64_t hash = FNV_OFFSET_BASIS;
+  size_t pos = 0;
+  for (size_t l = 0; l < m_levels.size(); l++) {
+    const struct PrefixFilterLevel* level = &m_levels[l];
+    if (level->length > rNumber.length()) {
+      break;
+    }
+    for (; pos < level->length; pos++) {
+      hash = (hash ^ (uint8_t)rNumber[pos]) * FNV_PRIME;
+    }
+    uint64_t h = mix(hash);
+    uint64_t h1 = h & 0xffffffff, h2 = (h >> 32) | 1;
+    uint32_t k = 0;
+    while (k < level->numHashes) {
+      uint64_t bit = (h1 + k * h2) % level->numBits;
+      if ((level->bits[bit / 64] & (1ULL << (bit % 64))) == 0) break;
+      k++;
+    }
+    if (k == level->numHashes) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t PrefixFilter::getSize() const {
+  size_t size = 0;
+  for (size_t l = 0; l < m_levels.size(); l++) {
+    size += m_levels[l].bits.size() * sizeof(uint64_t);
+  }
+  return size;
+}
+
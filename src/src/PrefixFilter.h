@@ -0,0 +1,59 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef PREFIXFILTER_H
+#define PREFIXFILTER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+
+// one bloom filter over all keys of the same length
+struct PrefixFilterLevel {
+  size_t length;
+  uint32_t numHashes;
+  uint64_t numBits;
+  std::vector<uint64_t> bits;
+};
+
+// Probabilistic set of keys, answering if a key could be a prefix of a number.
+// Each key length present gets its own bloom filter, a number is checked with
+// its prefix of each of these lengths. A negative answer is always correct.
+class PrefixFilter {
+private:
+  std::vector<struct PrefixFilterLevel> m_levels; // ordered by length
+
+public:
+  PrefixFilter();
+  virtual ~PrefixFilter();
+
+  void build(const std::vector<const char*>& rKeys, const std::vector<size_t>& rLengths, double fpRate);
+  void clear();
+  bool isEmpty() const { return m_levels.empty(); }
+  bool mayContainPrefixOf(const std::string& rNumber) const;
+  size_t getNumLevels() const { return m_levels.size(); }
+  size_t getSize() const;
+
+private:
+  static uint64_t mix(uint64_t hash);
+};
+
+#endif
+
@@ -0,0 +1,235 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "ScriptWorker.h" // API
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <json-c/json.h>
+#include <boost/algorithm/string.hpp>
+
+#include "Logger.h"
+#include "Helper.h"
+
+
+ScriptWorker::ScriptWorker(const std::string& rScript) {
+  Logger::debug("ScriptWorker::ScriptWorker(%s)...", rScript.c_str());
+  m_script = rScript;
+  m_pid = -1;
+  m_fd = -1;
+  m_answered = false;
+  m_failures = 0;
+  m_retryTime = 0;
+}
+
+ScriptWorker::~ScriptWorker() {
+  Logger::debug("ScriptWorker::~ScriptWorker()...");
+  std::lock_guard<std::mutex> lock(m_mutex);
+  stop();
+}
+
+bool ScriptWorker::start() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_pid > 0 || startLocked();
+}
+
+bool ScriptWorker::startLocked() {
+  if (time(NULL) < m_retryTime) {
+    return false;
+  }
+
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+    Logger::warn("socketpair failed (%s)", strerror(errno));
+    return false;
+  }
+  std::string wrapper = m_script.substr(0, m_script.rfind('/') + 1) + SCRIPTWORKER_WRAPPER;
+  pid_t pid = fork();
+  if (pid < 0) {
+    Logger::warn("fork failed (%s)", strerror(errno));
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+  if (pid == 0) {
+    // dup2() clears close-on-exec of the copies
+    dup2(fds[1], STDIN_FILENO);
+    dup2(fds[1], STDOUT_FILENO);
+    // the signals read by the main loop are blocked, but not for the script
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigprocmask(SIG_SETMASK, &signals, NULL);
+    execl(wrapper.c_str(), wrapper.c_str(), m_script.c_str(), (char*)NULL);
+    _exit(127);
+  }
+  close(fds[1]);
+  m_pid = pid;
+  m_fd = fds[0];
+  m_buffer.clear();
+  m_answered = false;
+  Logger::info("started worker for %s (pid %d)", m_script.c_str(), (int)m_pid);
+  return true;
+}
+
+void ScriptWorker::stop() {
+  if (m_fd >= 0) {
+    close(m_fd);
+    m_fd = -1;
+  }
+  if (m_pid > 0) {
+    // the worker exits on the end of its input, a hanging one is killed
+    if (waitpid(m_pid, NULL, WNOHANG) != m_pid) {
+      kill(m_pid, SIGKILL);
+      (void)waitpid(m_pid, NULL, 0);
+    }
+    m_pid = -1;
+  }
+}
+
+// stops the worker, one failing again and again is not started for a while, the script is run one-shot meanwhile
+void ScriptWorker::failed(bool retryLater) {
+  stop();
+  m_failures++;
+  if (retryLater || m_failures >= SCRIPTWORKER_MAX_FAILURES) {
+    Logger::warn("worker for %s keeps failing, not started for %d s", m_script.c_str(), SCRIPTWORKER_RETRY_SEC);
+    m_retryTime = time(NULL) + SCRIPTWORKER_RETRY_SEC;
+    m_failures = 0;
+  }
+}
+
+enum ScriptWorkerResult ScriptWorker::execute(const std::vector<const char*>& rArgs, std::string* pRes) {
+  std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return SCRIPTWORKER_BUSY;
+  }
+  if (m_pid > 0 && waitpid(m_pid, NULL, WNOHANG) == m_pid) {
+    Logger::warn("worker for %s died, restarting it", m_script.c_str());
+    m_pid = -1;
+    failed(false);
+  }
+  // only a worker answering again and again is healthy, not one restarted for each request
+  bool running = m_pid > 0;
+  if (m_pid <= 0 && !startLocked()) {
+    return SCRIPTWORKER_UNAVAILABLE;
+  }
+
+  std::string request = "{\"args\": [";
+  for(size_t i = 0; i < rArgs.size(); i++) {
+    if (i != 0) request += ", ";
+    request += "\"" + Helper::escapeJsonString(rArgs[i]) + "\"";
+  }
+  request += "]}\n";
+  Logger::debug("request to worker %s: %s", m_script.c_str(), request.c_str());
+
+  std::string line;
+  if (!writeAll(request) || !readLine(&line)) {
+    if (m_fd >= 0) {
+      Logger::warn("worker for %s timed out", m_script.c_str());
+      failed(false);
+      return SCRIPTWORKER_FAILED;
+    }
+    // a worker, which never answered, is not started again for a while
+    Logger::warn("worker for %s failed, running the script one-shot", m_script.c_str());
+    failed(!m_answered);
+    return SCRIPTWORKER_UNAVAILABLE;
+  }
+
+  m_answered = true;
+  struct json_object* root = json_tokener_parse(line.c_str());
+  int exitCode;
+  std::string output;
+  bool valid = Helper::getObject(root, "exit", true, m_script, &exitCode) &&
+               Helper::getObject(root, "output", true, m_script, &output);
+  if (root != NULL) json_object_put(root);
+  if (!valid) {
+    failed(false);
+    return SCRIPTWORKER_FAILED;
+  }
+  if (running) m_failures = 0;
+  boost::algorithm::trim(output);
+  if (exitCode != 0) {
+    Logger::warn("%s failed (%s)", m_script.c_str(), output.c_str());
+    return SCRIPTWORKER_FAILED;
+  }
+  Logger::debug("result: %s", output.c_str());
+  *pRes = output;
+  return SCRIPTWORKER_OK;
+}
+
+bool ScriptWorker::writeAll(const std::string& rData) {
+  size_t pos = 0;
+  while (pos < rData.length()) {
+    ssize_t len = send(m_fd, rData.data() + pos, rData.length() - pos, MSG_NOSIGNAL);
+    if (len < 0 && errno == EINTR) continue;
+    if (len <= 0) {
+      close(m_fd);
+      m_fd = -1;
+      return false;
+    }
+    pos += len;
+  }
+  return true;
+}
+
+// false and m_fd closed, when the worker has gone; false and m_fd open on timeout
+bool ScriptWorker::readLine(std::string* pLine) {
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while (true) {
+    size_t eol = m_buffer.find('\n');
+    if (eol != std::string::npos) {
+      *pLine = m_buffer.substr(0, eol);
+      m_buffer.erase(0, eol + 1);
+      return true;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long elapsedMs = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+    if (elapsedMs >= SCRIPTWORKER_TIMEOUT_MS) {
+      return false;
+    }
+    struct pollfd pfd = {m_fd, POLLIN, 0};
+    int ret = poll(&pfd, 1, SCRIPTWORKER_TIMEOUT_MS - elapsedMs);
+    if (ret < 0 && errno == EINTR) continue;
+    if (ret <= 0) {
+      if (ret < 0) Logger::warn("poll failed (%s)", strerror(errno));
+      return false;
+    }
+
+    char buf[512];
+    ssize_t len = recv(m_fd, buf, sizeof(buf), 0);
+    if (len < 0 && errno == EINTR) continue;
+    if (len <= 0) {
+      close(m_fd);
+      m_fd = -1;
+      return false;
+    }
+    m_buffer.append(buf, len);
+  }
+}
+
@@ -0,0 +1,74 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef SCRIPTWORKER_H
+#define SCRIPTWORKER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <time.h>
+#include <sys/types.h>
+
+
+#define SCRIPTWORKER_WRAPPER      "script_worker.py"  // in the directory of the scripts
+#define SCRIPTWORKER_TIMEOUT_MS   15000               // for one request
+#define SCRIPTWORKER_RETRY_SEC    60                  // after a worker died before its first answer or failed too often
+#define SCRIPTWORKER_MAX_FAILURES 3                   // in a row, before the worker is not started for a while
+
+enum ScriptWorkerResult {
+  SCRIPTWORKER_OK = 0,
+  SCRIPTWORKER_FAILED,          // the script failed or timed out, already logged
+  SCRIPTWORKER_UNAVAILABLE,     // no worker is running, the script has to be run one-shot
+  SCRIPTWORKER_BUSY             // the worker runs another request, it is not waited for
+};
+
+// Runs a script as long-lived process (see scripts/script_worker.py), so its
+// interpreter and modules are only started once. Each request is a JSON line
+// {"args": [...]} on its stdin, each response a JSON line {"exit": N, "output": "..."}
+// on its stdout. A worker, which died, is started again by the next request.
+// A worker runs one request at a time, Block keeps several for concurrent calls.
+class ScriptWorker {
+private:
+  std::string m_script;
+  std::mutex m_mutex;   // one request at a time
+  pid_t m_pid;
+  int m_fd;             // socket connected to stdin and stdout of the worker
+  std::string m_buffer;
+  bool m_answered;      // the running worker has answered a request
+  unsigned int m_failures;  // requests in a row, which stopped the worker
+  time_t m_retryTime;
+
+public:
+  ScriptWorker(const std::string& rScript);
+  virtual ~ScriptWorker();
+
+  bool start();
+  enum ScriptWorkerResult execute(const std::vector<const char*>& rArgs, std::string* pRes);
+
+private:
+  bool startLocked();
+  void stop();
+  void failed(bool retryLater);
+  bool writeAll(const std::string& rData);
+  bool readLine(std::string* pLine);
+};
+
+#endif
+
@@ -31,9 +31,23 @@
 #include "Helper.h"
 
 
+#define ONLINE_CACHE_POSITIVE_TTL   (7 * 24 * 60 * 60)
+#define ONLINE_CACHE_NEGATIVE_TTL   (24 * 60 * 60)
+#define ONLINE_DEADLINE_MS          10000
+#define ONLINE_BREAKER_FAILURES     3
+#define SIP_MAX_CALLS               4
+
+
 Settings::Settings() : Notify(SYSCONFDIR "/" PACKAGE_NAME, IN_CLOSE_WRITE) {
   Logger::debug("Settings::Settings()...");
   m_filename = SYSCONFDIR "/" PACKAGE_NAME "/configs/settings.json";
+  m_listFilterFpRate = 0;
+  m_onlineCachePositiveTtl = ONLINE_CACHE_POSITIVE_TTL;
+  m_onlineCacheNegativeTtl = ONLINE_CACHE_NEGATIVE_TTL;
+  m_scriptWorkers = true;
+  m_onlineDeadlineMs = ONLINE_DEADLINE_MS;
+  m_onlineBreakerFailures = ONLINE_BREAKER_FAILURES;
+  m_sipMaxCalls = SIP_MAX_CALLS;
   load();
 }
 
@@ -84,6 +98,57 @@ bool Settings::load() {
     pj_log_set_level(pjsip_log_level);
   }
 
+  // optional prefix filter in front of the lists, only read on startup
+  double listFilterFpRate;
+  if (Helper::getObject(root, "list_filter_fp_rate", false, m_filename, &listFilterFpRate)) {
+    if (listFilterFpRate < 0 || listFilterFpRate >= 1) {
+      Logger::warn("invalid list_filter_fp_rate %f in settings file %s", listFilterFpRate, m_filename.c_str());
+    } else {
+      m_listFilterFpRate = listFilterFpRate;
+    }
+  }
+
+  // time to live of cached online check and lookup results
+  m_onlineCachePositiveTtl = ONLINE_CACHE_POSITIVE_TTL;
+  m_onlineCacheNegativeTtl = ONLINE_CACHE_NEGATIVE_TTL;
+  int ttl;
+  if (Helper::getObject(root, "online_cache_positive_ttl", false, m_filename, &ttl)) {
+    if (ttl < 0) Logger::warn("invalid online_cache_positive_ttl %d in settings file %s", ttl, m_filename.c_str());
+    else m_onlineCachePositiveTtl = ttl;
+  }
+  if (Helper::getObject(root, "online_cache_negative_ttl", false, m_filename, &ttl)) {
+    if (ttl < 0) Logger::warn("invalid online_cache_negative_ttl %d in settings file %s", ttl, m_filename.c_str());
+    else m_onlineCacheNegativeTtl = ttl;
+  }
+
+  // scripts run as long-lived workers, otherwise one-shot for each call
+  m_scriptWorkers = true;
+  (void)Helper::getObject(root, "script_workers", false, m_filename, &m_scriptWorkers);
+
+  // how long a call waits for the online check and lookup
+  m_onlineDeadlineMs = ONLINE_DEADLINE_MS;
+  int deadline;
+  if (Helper::getObject(root, "online_deadline_ms", false, m_filename, &deadline)) {
+    if (deadline <= 0) Logger::warn("invalid online_deadline_ms %d in settings file %s", deadline, m_filename.c_str());
+    else m_onlineDeadlineMs = deadline;
+  }
+
+  // consecutive failures of an online script, until it is skipped for a while
+  m_onlineBreakerFailures = ONLINE_BREAKER_FAILURES;
+  int failures;
+  if (Helper::getObject(root, "online_breaker_failures", false, m_filename, &failures)) {
+    if (failures < 0) Logger::warn("invalid online_breaker_failures %d in settings file %s", failures, m_filename.c_str());
+    else m_onlineBreakerFailures = failures;
+  }
+
+  // simultaneous SIP calls, only read on startup
+  m_sipMaxCalls = SIP_MAX_CALLS;
+  int maxCalls;
+  if (Helper::getObject(root, "sip_max_calls", false, m_filename, &maxCalls)) {
+    if (maxCalls <= 0) Logger::warn("invalid sip_max_calls %d in settings file %s", maxCalls, m_filename.c_str());
+    else m_sipMaxCalls = maxCalls;
+  }
+
   // Phones
   struct json_object* phones;
   if (json_object_object_get_ex(root, "phones", &phones)) {
@@ -119,6 +184,9 @@ bool Settings::load() {
         if (!Helper::getObject(entry, "from_password", true, m_filename, &sip.fromPassword)) {
           continue;
         }
+        if (!getSipReject(entry, &sip)) {
+          continue;
+        }
         m_sipAccounts.push_back(sip);
       }
     }
@@ -151,6 +219,10 @@ bool Settings::load() {
     Logger::warn("no <online_credentials> section found in settings file %s", m_filename.c_str());
   }
 
+  // invocations of the online scripts, the phones and credentials are known now
+  for(size_t i = 0; i < m_sipAccounts.size(); i++) compileOnlineScripts(&m_sipAccounts[i].base);
+  for(size_t i = 0; i < m_analogPhones.size(); i++) compileOnlineScripts(&m_analogPhones[i].base);
+
   json_object_put(root); // free
   return true;
 }
@@ -191,6 +263,61 @@ bool Settings::getBase(struct json_object* objbase, struct SettingBase* res) {
   return true;
 }
 
+bool Settings::getSipReject(struct json_object* objbase, struct SettingSipAccount* res) {
+  res->rejectMode = SIP_REJECT_ANSWER;
+  res->redirectUri = "";
+  std::string tmp;
+  if (!Helper::getObject(objbase, "reject_mode", false, m_filename, &tmp)) {
+    return true;
+  }
+  if (tmp == "answer") res->rejectMode = SIP_REJECT_ANSWER;
+  else if (tmp == "busy") res->rejectMode = SIP_REJECT_BUSY;
+  else if (tmp == "decline") res->rejectMode = SIP_REJECT_DECLINE;
+  else if (tmp == "not_found") res->rejectMode = SIP_REJECT_NOT_FOUND;
+  else if (tmp == "redirect") res->rejectMode = SIP_REJECT_REDIRECT;
+  else {
+    Logger::warn("unknown reject_mode '%s' in settings file %s", tmp.c_str(), m_filename.c_str());
+    return false;
+  }
+  if (res->rejectMode == SIP_REJECT_REDIRECT) {
+    if (!Helper::getObject(objbase, "redirect_uri", true, m_filename, &res->redirectUri)) {
+      return false;
+    }
+    if (!boost::starts_with(res->redirectUri, "sip:") && !boost::starts_with(res->redirectUri, "sips:")) {
+      Logger::warn("invalid redirect_uri '%s' in settings file %s", res->redirectUri.c_str(), m_filename.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+void Settings::compileOnlineScripts(struct SettingBase* pBase) {
+  if (pBase->onlineCheck.length() != 0) {
+    pBase->onlineCheckScript = compileOnlineScript("onlinecheck_", pBase->onlineCheck);
+  }
+  if (pBase->onlineLookup.length() != 0) {
+    pBase->onlineLookupScript = compileOnlineScript("onlinelookup_", pBase->onlineLookup);
+  }
+}
+
+std::shared_ptr<const struct SettingOnlineScript> Settings::compileOnlineScript(const std::string& rPrefix, const std::string& rName) {
+  std::shared_ptr<struct SettingOnlineScript> res = std::make_shared<struct SettingOnlineScript>();
+  res->name = rPrefix + rName;
+  res->script = SCRIPTS_DIR + res->name + ".py";
+  for(size_t i = 0; i < m_onlineCredentials.size(); i++) {
+    struct SettingOnlineCredential* cred = &m_onlineCredentials[i];
+    if (cred->name == rName) {
+      for (std::map<std::string,std::string>::iterator it = cred->data.begin(); it != cred->data.end(); ++it) {
+        res->args.push_back("--" + it->first + "=" + it->second);
+        res->credentials.push_back(it->first);
+        res->credentials.push_back(it->second);
+      }
+      break;
+    }
+  }
+  return res;
+}
+
 void Settings::dump() {
   // TODO?
 }
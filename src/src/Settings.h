@@ -24,11 +24,15 @@
 #include <sstream>
 #include <vector>
 #include <map>
+#include <memory>
 
 #include "Notify.h"
 struct json_object;
 
 
+#define SCRIPTS_DIR   "/usr/callblocker/scripts/"
+
+
 enum SettingBlockMode {
   LOGGING_ONLY = 0,             // number is never blocked, only logged what it would do
   WHITELISTS_ONLY,              // number is blocked, when NOT in a whitelists (blacklists not used at all)
@@ -36,6 +40,14 @@ enum SettingBlockMode {
   BLACKLISTS_ONLY               // number is blocked, when in a blacklists (whitelists not used at all)
 };
 
+// invocation of an online check or lookup, compiled once when the settings are loaded
+struct SettingOnlineScript {
+  std::string name;                      // e.g. onlinecheck_<name>
+  std::string script;                    // path of the script
+  std::vector<std::string> args;         // "--key=value" of the credentials, following "--number <number>"
+  std::vector<std::string> credentials;  // key, value, ... of the credentials, for plugins
+};
+
 struct SettingBase {
   std::string name;
   std::string countryCode;
@@ -43,6 +55,8 @@ struct SettingBase {
   bool blockAnonymousCID;
   std::string onlineCheck;
   std::string onlineLookup;
+  std::shared_ptr<const struct SettingOnlineScript> onlineCheckScript;   // NULL if no online check
+  std::shared_ptr<const struct SettingOnlineScript> onlineLookupScript;  // NULL if no online lookup
 
   std::string toString() const {
     std::ostringstream oss;
@@ -51,15 +65,26 @@ struct SettingBase {
   }
 };
 
+enum SettingSipRejectMode {
+  SIP_REJECT_ANSWER = 0,        // call is answered and hung up again
+  SIP_REJECT_BUSY,              // 486 Busy Here
+  SIP_REJECT_DECLINE,           // 603 Decline
+  SIP_REJECT_NOT_FOUND,         // 404 Not Found
+  SIP_REJECT_REDIRECT           // 302 Moved Temporarily, to redirectUri
+};
+
 struct SettingSipAccount {
   struct SettingBase base;
   std::string fromDomain;
   std::string fromUsername;
   std::string fromPassword;
+  enum SettingSipRejectMode rejectMode;
+  std::string redirectUri;
 
   std::string toString() const {
     std::ostringstream oss;
     oss << base.toString() << ",fd=" << fromDomain << ",fu=" << fromUsername;// << ",fp=" << fromPassword;
+    oss << ",rm=" << rejectMode << ",ru=" << redirectUri;
     return oss.str();
   }
 };
@@ -83,6 +108,13 @@ struct SettingOnlineCredential {
 class Settings : public Notify {
 private:
   std::string m_filename;
+  double m_listFilterFpRate;
+  int m_onlineCachePositiveTtl;
+  int m_onlineCacheNegativeTtl;
+  bool m_scriptWorkers;
+  int m_onlineDeadlineMs;
+  int m_onlineBreakerFailures;
+  int m_sipMaxCalls;
   std::vector<struct SettingSipAccount> m_sipAccounts;
   std::vector<struct SettingAnalogPhone> m_analogPhones;
   std::vector<struct SettingOnlineCredential> m_onlineCredentials;
@@ -92,6 +124,13 @@ public:
   virtual ~Settings();
   virtual bool hasChanged();
 
+  double getListFilterFpRate() { return m_listFilterFpRate; }
+  int getOnlineCachePositiveTtl() { return m_onlineCachePositiveTtl; }
+  int getOnlineCacheNegativeTtl() { return m_onlineCacheNegativeTtl; }
+  bool getScriptWorkers() { return m_scriptWorkers; }
+  int getOnlineDeadlineMs() { return m_onlineDeadlineMs; }
+  int getOnlineBreakerFailures() { return m_onlineBreakerFailures; }
+  int getSipMaxCalls() { return m_sipMaxCalls; }
   std::vector<struct SettingSipAccount> getSipAccounts() { return m_sipAccounts; }
   std::vector<struct SettingAnalogPhone> getAnalogPhones() { return m_analogPhones; }
   std::vector<struct SettingOnlineCredential> getOnlineCredentials() { return m_onlineCredentials; }
@@ -102,6 +141,9 @@ private:
   bool load();
   bool getBlockMode(struct json_object* objbase, enum SettingBlockMode* res);
   bool getBase(struct json_object* objbase, struct SettingBase* res);
+  bool getSipReject(struct json_object* objbase, struct SettingSipAccount* res);
+  void compileOnlineScripts(struct SettingBase* pBase);
+  std::shared_ptr<const struct SettingOnlineScript> compileOnlineScript(const std::string& rPrefix, const std::string& rName);
 };
 
 #endif
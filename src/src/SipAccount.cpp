@@ -21,6 +21,8 @@
 
 #include <string>
 #include <sstream>
+#include <algorithm>
+#include <string.h>
 #include <unistd.h>
 #include <pjsua-lib/pjsua.h>
 #include <boost/algorithm/string/predicate.hpp>
@@ -34,12 +36,50 @@ SipAccount::SipAccount(SipPhone* pPhone) {
   Logger::debug("SipAccount::SipAccount()...");
   m_pPhone = pPhone;
   m_accId = -1;
+  m_stopping = false;
+  for(unsigned int i = 0; i < std::max(m_pPhone->getMaxCalls(), 1u); i++) {
+    m_workers.push_back(std::thread(&SipAccount::runWorker, this));
+  }
 }
 
 SipAccount::~SipAccount() {
   Logger::debug("SipAccount::~SipAccount()...");
+  std::deque<struct SipAccountCall> requests;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    requests.swap(m_requests);
+  }
+  m_cond.notify_all();
+  for(size_t i = 0; i < m_workers.size(); i++) {
+    m_workers[i].join(); // a decision being taken no longer waits for scripts, so the main loop is not held up
+  }
   m_pPhone = NULL;
 
+  // calls not decided yet are released, they would ring here forever otherwise
+  for(size_t i = 0; i < requests.size(); i++) {
+    Logger::info("call %s of %s not decided, the account was removed", requests[i].sipCallId.c_str(),
+      requests[i].number.c_str());
+    if (!isRinging(requests[i])) {
+      continue;
+    }
+    pj_status_t status = pjsua_call_hangup(requests[i].id, PJSIP_SC_TEMPORARILY_UNAVAILABLE, NULL, NULL);
+    if (status != PJ_SUCCESS) {
+      Logger::warn("pjsua_call_hangup() failed (%s)", Helper::getPjStatusAsString(status).c_str());
+    }
+  }
+
+  // calls still running are no longer handled by this account
+  pjsua_call_id ids[PJSUA_MAX_CALLS];
+  unsigned int count = PJSUA_MAX_CALLS;
+  if (pjsua_enum_calls(ids, &count) == PJ_SUCCESS) {
+    for(unsigned int i = 0; i < count; i++) {
+      if (pjsua_call_get_user_data(ids[i]) == this) {
+        (void)pjsua_call_set_user_data(ids[i], NULL);
+      }
+    }
+  }
+
   if (m_accId == -1) {
     return;
   }
@@ -130,40 +170,115 @@ void SipAccount::onIncomingCall(pjsua_call_id call_id, pjsip_rx_data *rdata) {
     return;
   }
 
+  // ringing, until the worker has taken the decision
+  status = pjsua_call_answer(call_id, PJSIP_SC_RINGING, NULL, NULL);
+  if (status != PJ_SUCCESS) {
+    Logger::warn("pjsua_call_answer() failed (%s)", Helper::getPjStatusAsString(status).c_str());
+  }
+
+  struct SipAccountCall call;
+  call.id = call_id;
+  call.sipCallId = std::string(pj_strbuf(&ci.call_id), ci.call_id.slen);
+  call.number = number;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_requests.push_back(call);
+  }
+  m_cond.notify_all();
+}
+
+void SipAccount::runWorker() {
+  // pjsua may only be called by threads known to pjlib
+  pj_thread_desc desc;
+  pj_thread_t* thread;
+  memset(desc, 0, sizeof(desc));
+  pj_status_t status = pj_thread_register("SipAccount", desc, &thread);
+  if (status != PJ_SUCCESS) {
+    Logger::warn("pj_thread_register() failed (%s)", Helper::getPjStatusAsString(status).c_str());
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_cond.wait(lock, [this] { return m_stopping || !m_requests.empty(); });
+    if (m_stopping) {
+      break;
+    }
+    struct SipAccountCall call = m_requests.front();
+    m_requests.pop_front();
+    lock.unlock();
+    decide(call);
+    lock.lock();
+  }
+}
+
+void SipAccount::decide(const struct SipAccountCall& rCall) {
   std::string msg;
   bool block = false;
-  if (number == "anonymous" or number == "") {
-    block = m_pPhone->isAnonymousNumberBlocked(&m_settings.base, &msg);
+  if (rCall.number == "anonymous" or rCall.number == "") {
+    block = m_pPhone->isAnonymousNumberBlocked(&m_settings.base, &m_stopping, &msg);
   } else {
-    block = m_pPhone->isNumberBlocked(&m_settings.base, number, &msg);
+    block = m_pPhone->isNumberBlocked(&m_settings.base, rCall.number, &m_stopping, &msg);
   }
   Logger::notice(msg.c_str());
 
-#if 0
-  // 302 redirect
-  Use pjsua_call_hangup() and put the destination URL in the Contact
-  header of the pjsua_msg_data.
-
-  pj_pool_t* pool = pjsua_pool_create("", 512, 512);
-  pjsua_msg_data msgData;
-  pjsua_msg_data_init(&msgData);
-
-  pj_str_t tmp;
-  pjsip_generic_string_hdr* hdr =
-    pjsip_generic_string_hdr_create(pool, pj_cstr(&tmp, "Contact"), pj_cstr(&tmp, "URI ...TODO"));
-  pj_list_push_back(&msgData.hdr_list, hdr);
-  // codes: http://de.wikipedia.org/wiki/SIP-Status-Codes
-   // enum pjsip_status_code...
-  pjsua_call_hangup(call_id, PJSIP_SC_MOVED_TEMPORARILY, NULL, &msgData);
-  pj_pool_release(pool);
-#endif
+  if (!block) {
+    return;
+  }
 
-  if (block) {
-    // answer incoming calls with 200/OK, then we hangup in onCallState...
-    pj_status_t status = pjsua_call_answer(call_id, 200, NULL, NULL);
-    if (status != PJ_SUCCESS) {
-      Logger::warn("pjsua_call_answer() failed (%s)", Helper::getPjStatusAsString(status).c_str());
+  if (!isRinging(rCall)) {
+    Logger::debug("call of %s already ended, not blocked anymore", rCall.number.c_str());
+    return;
+  }
+
+  reject(rCall.id);
+}
+
+// the caller may have hung up meanwhile, or the id may belong to another call by now
+bool SipAccount::isRinging(const struct SipAccountCall& rCall) {
+  pjsua_call_info ci;
+  return pjsua_call_get_info(rCall.id, &ci) == PJ_SUCCESS &&
+    std::string(pj_strbuf(&ci.call_id), ci.call_id.slen) == rCall.sipCallId &&
+    (ci.state == PJSIP_INV_STATE_INCOMING || ci.state == PJSIP_INV_STATE_EARLY);
+}
+
+void SipAccount::reject(pjsua_call_id call_id) {
+  pj_status_t status;
+  switch (m_settings.rejectMode) {
+    case SIP_REJECT_ANSWER:
+      // answer incoming calls with 200/OK, then we hangup in onCallState...
+      status = pjsua_call_answer(call_id, 200, NULL, NULL);
+      if (status != PJ_SUCCESS) {
+        Logger::warn("pjsua_call_answer() failed (%s)", Helper::getPjStatusAsString(status).c_str());
+      }
+      return;
+    case SIP_REJECT_REDIRECT: {
+      // the destination goes into the Contact header of the final response
+      pj_pool_t* pool = pjsua_pool_create("", 512, 512);
+      pjsua_msg_data msgData;
+      pjsua_msg_data_init(&msgData);
+      std::string contact = "<" + m_settings.redirectUri + ">";
+      pj_str_t name, value;
+      pjsip_generic_string_hdr* hdr = pjsip_generic_string_hdr_create(pool, pj_cstr(&name, "Contact"),
+        pj_cstr(&value, contact.c_str()));
+      pj_list_push_back(&msgData.hdr_list, hdr);
+      status = pjsua_call_hangup(call_id, PJSIP_SC_MOVED_TEMPORARILY, NULL, &msgData);
+      pj_pool_release(pool);
+      break;
     }
+    case SIP_REJECT_BUSY:
+      status = pjsua_call_hangup(call_id, PJSIP_SC_BUSY_HERE, NULL, NULL);
+      break;
+    case SIP_REJECT_DECLINE:
+      status = pjsua_call_hangup(call_id, PJSIP_SC_DECLINE, NULL, NULL);
+      break;
+    case SIP_REJECT_NOT_FOUND:
+    default:
+      status = pjsua_call_hangup(call_id, PJSIP_SC_NOT_FOUND, NULL, NULL);
+      break;
+  }
+  // a final response ends the call, no media is set up
+  if (status != PJ_SUCCESS) {
+    Logger::warn("pjsua_call_hangup() failed (%s)", Helper::getPjStatusAsString(status).c_str());
   }
 }
 
@@ -181,7 +296,16 @@ void SipAccount::onCallState(pjsua_call_id call_id, pjsip_event* e) {
   PJ_UNUSED_ARG(e);
 
   pjsua_call_info ci;
-  pjsua_call_get_info(call_id, &ci);
+  pj_status_t status = pjsua_call_get_info(call_id, &ci);
+  if (status != PJ_SUCCESS) {
+    Logger::warn("pjsua_call_get_info() failed (%s)", Helper::getPjStatusAsString(status).c_str());
+    return;
+  }
+
+  if (ci.state == PJSIP_INV_STATE_DISCONNECTED) {
+    // the call id is reused by the next call, possibly of another account
+    (void)pjsua_call_set_user_data(call_id, NULL);
+  }
 
   std::string display, number;
   if (!getNumber(&ci.remote_info, &display, &number)) {
@@ -196,7 +320,7 @@ void SipAccount::onCallState(pjsua_call_id call_id, pjsip_event* e) {
   if (ci.state == PJSIP_INV_STATE_CONFIRMED) {
     Logger::debug("hangup...");
     // code 0: pj takes care of hangup SIP status code
-    pj_status_t status = pjsua_call_hangup(call_id, 0, NULL, NULL);
+    status = pjsua_call_hangup(call_id, 0, NULL, NULL);
     if (status != PJ_SUCCESS) {
       Logger::warn("pjsua_call_hangup() failed (%s)", Helper::getPjStatusAsString(status).c_str());
     }
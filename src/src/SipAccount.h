@@ -20,18 +20,39 @@
 #ifndef SIPACCOUNT_H
 #define SIPACCOUNT_H
 
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <pjsua-lib/pjsua.h>
 
 #include "SipPhone.h"
 #include "Settings.h"
 
 
+struct SipAccountCall {
+  pjsua_call_id id;
+  std::string sipCallId;  // Call-ID header, the pjsua call id may be reused meanwhile
+  std::string number;
+};
+
 class SipAccount {
 private:
   SipPhone* m_pPhone;
   struct SettingSipAccount m_settings;
   pjsua_acc_id m_accId;
 
+  // the decisions are taken by workers, so the pjsip thread never waits for lists or scripts,
+  // one for each simultaneous call
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<struct SipAccountCall> m_requests;
+  std::atomic<bool> m_stopping;  // also stops a decision waiting for scripts
+
 public:
   SipAccount(SipPhone* pPhone);
   virtual ~SipAccount();
@@ -46,6 +67,10 @@ private:
   void onCallState(pjsua_call_id call_id, pjsip_event* e);
   //void onCallMediaState(pjsua_call_id call_id);
   bool getNumber(pj_str_t* uri_str, std::string* pDisplay, std::string* pNumber);
+  void runWorker();
+  void decide(const struct SipAccountCall& rCall);
+  bool isRinging(const struct SipAccountCall& rCall);
+  void reject(pjsua_call_id call_id);
 };
 
 #endif
@@ -30,6 +30,7 @@
 // transport_srtp  ..Failed to initialize libsrtp: unsupported parameter
 //  pjsua_media.c  ..Error initializing SRTP library: unsupported parameter [status=259801]
 static bool s_Initialized = false;
+static unsigned int s_maxCalls = 0;
 
 
 // TODO
@@ -66,12 +67,13 @@ SipPhone::~SipPhone() {
 #endif
 }
 
-bool SipPhone::init() {
+// maxCalls: only used the first time, see s_Initialized
+bool SipPhone::init(unsigned int maxCalls) {
   Logger::debug("SipPhone::init...");
 
   if (!s_Initialized)
   {
-    if (!init_pjsua()) return false;
+    if (!init_pjsua(maxCalls)) return false;
     if (!init_pjmedia()) return false;
     s_Initialized = true;
   }
@@ -79,7 +81,11 @@ bool SipPhone::init() {
   return true;
 }
 
-bool SipPhone::init_pjsua() {
+unsigned int SipPhone::getMaxCalls() {
+  return s_maxCalls;
+}
+
+bool SipPhone::init_pjsua(unsigned int maxCalls) {
   Logger::debug("SipPhone::init_pjsua...");
 
   // create pjsua  
@@ -92,8 +98,12 @@ bool SipPhone::init_pjsua() {
   // configure pjsua
   pjsua_config ua_cfg;
   pjsua_config_default(&ua_cfg);
-  // enable just 1 simultaneous call 
-  ua_cfg.max_calls = 1; // TODO
+  // simultaneous calls, e.g. several numbers of the same spammer ringing at once
+  if (maxCalls > PJSUA_MAX_CALLS) {
+    Logger::warn("sip_max_calls %u exceeds %d supported by pjsua", maxCalls, PJSUA_MAX_CALLS);
+    maxCalls = PJSUA_MAX_CALLS;
+  }
+  ua_cfg.max_calls = s_maxCalls = maxCalls;
   // callback configuration
   ua_cfg.cb.on_call_state = &SipAccount::onCallStateCB;
   ua_cfg.cb.on_incoming_call = &SipAccount::onIncomingCallCB;
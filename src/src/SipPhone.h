@@ -37,13 +37,14 @@ private:
 public:
   SipPhone(Block* pBlock);
   virtual ~SipPhone();
-  bool init();
+  bool init(unsigned int maxCalls);
+  unsigned int getMaxCalls();
 
 #if 0
   pjsua_conf_port_id getMediaConfSilenceId() { return m_mediaConfSilenceId; }
 #endif
 private:
-  bool init_pjsua();
+  bool init_pjsua(unsigned int maxCalls);
   bool init_pjmedia();
 };
 
@@ -0,0 +1,61 @@
+/*
+ callblocker - blocking unwanted calls from your home phone
+ Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 3
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+// Local online check plugin, for testing without any online service. A number
+// is spam, if it starts with the credential "spam_prefix" (default "+999").
+// Its "name" credential is returned as caller name of spam numbers.
+
+#include <string.h>
+
+#include "../OnlinePluginApi.h"
+
+
+#define TEST_SPAM_PREFIX  "+999"
+#define TEST_NAME         "Test spam"
+#define TEST_SCORE        10
+
+
+static const char* getCredential(const char* const* credentials, const char* key, const char* defaultValue) {
+  for (size_t i = 0; credentials[i] != NULL && credentials[i + 1] != NULL; i += 2) {
+    if (strcmp(credentials[i], key) == 0) {
+      return credentials[i + 1];
+    }
+  }
+  return defaultValue;
+}
+
+static int check(const char* number, const char* const* credentials, callblocker_plugin_result result, void* context) {
+  const char* prefix = getCredential(credentials, "spam_prefix", TEST_SPAM_PREFIX);
+  if (strncmp(number, prefix, strlen(prefix)) == 0) {
+    result(context, 1, 1, TEST_SCORE, getCredential(credentials, "name", TEST_NAME));
+  } else {
+    result(context, 1, 0, -1, NULL);
+  }
+  return 1;
+}
+
+static const struct callblocker_plugin plugin = {
+  CALLBLOCKER_PLUGIN_API_VERSION,
+  check
+};
+
+extern "C" const struct callblocker_plugin* callblocker_plugin_init(void) {
+  return &plugin;
+}
+
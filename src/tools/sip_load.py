@@ -0,0 +1,227 @@
+#!/usr/bin/env python
+
+# callblocker - blocking unwanted calls from your home phone
+# Copyright (C) 2015-2015 Patrick Ammann <pammann@gmx.net>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 3
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+#
+
+# Load test: stands in for the SIP provider and sends N parallel INVITEs to a
+# running callblockerd, then reports how fast each call was ringing and blocked.
+
+from __future__ import print_function
+import sys, argparse
+import socket, select, time, random
+
+
+g_debug = False
+
+
+def error(*objs):
+  print("ERROR: ", *objs, file=sys.stderr)
+  sys.exit(-1)
+
+def debug(*objs):
+  if g_debug: print("DEBUG: ", *objs, file=sys.stdout)
+  return
+
+def new_id():
+  return "%08x%08x" % (random.getrandbits(32), random.getrandbits(32))
+
+
+class Call:
+  def __init__(self, index, number):
+    self.index = index
+    self.number = number
+    self.callId = new_id() + "@sip_load"
+    self.fromTag = new_id()
+    self.branch = "z9hG4bK" + new_id()
+    self.toHeader = None
+    self.start = None
+    self.ringing = None
+    self.final = None
+    self.finalCode = None
+    self.hungup = None
+
+
+class LoadTest:
+  def __init__(self, args):
+    self.args = args
+    self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    self.sock.bind((args.local_host, args.local_port))
+    self.local = self.sock.getsockname()
+    self.remote = (args.host, args.port)
+    self.calls = {}
+
+  def send(self, msg):
+    debug("send:\n" + msg)
+    self.sock.sendto(msg.encode("utf-8"), self.remote)
+
+  def headers(self, call, method, cseq, branch, toHeader):
+    return (
+      "Via: SIP/2.0/UDP %s:%d;branch=%s;rport\r\n" % (self.local[0], self.local[1], branch) +
+      "Max-Forwards: 70\r\n" +
+      "From: <sip:%s@%s>;tag=%s\r\n" % (call.number, self.local[0], call.fromTag) +
+      "To: %s\r\n" % toHeader +
+      "Call-ID: %s\r\n" % call.callId +
+      "CSeq: %d %s\r\n" % (cseq, method))
+
+  def uri(self):
+    return "sip:%s@%s:%d" % (self.args.user, self.remote[0], self.remote[1])
+
+  def sendInvite(self, call):
+    sdp = (
+      "v=0\r\n" +
+      "o=- %d 1 IN IP4 %s\r\n" % (call.index, self.local[0]) +
+      "s=sip_load\r\n" +
+      "c=IN IP4 %s\r\n" % self.local[0] +
+      "t=0 0\r\n" +
+      "m=audio %d RTP/AVP 0 8\r\n" % (40000 + 2 * call.index) +
+      "a=rtpmap:0 PCMU/8000\r\n" +
+      "a=rtpmap:8 PCMA/8000\r\n")
+    msg = ("INVITE %s SIP/2.0\r\n" % self.uri() +
+      self.headers(call, "INVITE", 1, call.branch, "<%s>" % self.uri()) +
+      "Contact: <sip:%s@%s:%d>\r\n" % (call.number, self.local[0], self.local[1]) +
+      "Content-Type: application/sdp\r\n" +
+      "Content-Length: %d\r\n\r\n" % len(sdp) + sdp)
+    call.start = time.time()
+    self.send(msg)
+
+  def sendAck(self, call, code):
+    # the ACK of a 2xx is a new transaction, the one of an error belongs to the INVITE
+    branch = call.branch if code >= 300 else "z9hG4bK" + new_id()
+    self.send("ACK %s SIP/2.0\r\n" % self.uri() +
+      self.headers(call, "ACK", 1, branch, call.toHeader) +
+      "Content-Length: 0\r\n\r\n")
+
+  def sendCancel(self, call):
+    self.send("CANCEL %s SIP/2.0\r\n" % self.uri() +
+      self.headers(call, "CANCEL", 1, call.branch, "<%s>" % self.uri()) +
+      "Content-Length: 0\r\n\r\n")
+
+  def sendResponse(self, headers, code, reason):
+    msg = "SIP/2.0 %d %s\r\n" % (code, reason)
+    for name in ["via", "from", "to", "call-id", "cseq"]:
+      if name in headers: msg += "%s: %s\r\n" % (name, headers[name])
+    self.send(msg + "Content-Length: 0\r\n\r\n")
+
+  def receive(self, data):
+    text = data.decode("utf-8", "replace")
+    debug("received:\n" + text)
+    lines = text.split("\r\n")
+    headers = {}
+    for line in lines[1:]:
+      if line == "": break
+      pos = line.find(":")
+      if pos > 0:
+        name = line[:pos].strip().lower()
+        name = {"i": "call-id", "f": "from", "t": "to", "v": "via"}.get(name, name)
+        if name not in headers: headers[name] = line[pos + 1:].strip()
+    call = self.calls.get(headers.get("call-id"))
+    if call is None:
+      debug("unknown call " + str(headers.get("call-id")))
+      return
+    now = time.time()
+
+    first = lines[0].split(" ", 2)
+    if first[0] == "SIP/2.0":
+      code = int(first[1])
+      if not headers.get("cseq", "").endswith("INVITE"): return
+      if code in (180, 183) and call.ringing is None:
+        call.ringing = now
+      elif code >= 200:
+        call.toHeader = headers.get("to")
+        if call.final is None:
+          call.final = now
+          call.finalCode = code
+        self.sendAck(call, code) # also for retransmissions
+    elif first[0] == "BYE":
+      if call.hungup is None: call.hungup = now
+      self.sendResponse(headers, 200, "OK")
+    else:
+      self.sendResponse(headers, 501, "Not Implemented")
+
+  def run(self):
+    for i in range(self.args.calls):
+      call = Call(i, "%s%03d" % (self.args.number, i))
+      self.calls[call.callId] = call
+    for call in self.calls.values():
+      self.sendInvite(call)
+
+    # ringing without being answered is a call let through, but wait for the BYE of blocked ones
+    end = time.time() + self.args.timeout
+    cancelled = False
+    while True:
+      now = time.time()
+      if not cancelled and now >= end:
+        for call in self.calls.values():
+          if call.final is None: self.sendCancel(call)
+        cancelled = True
+        end = now + 2
+      if cancelled and now >= end: break
+      if all(c.final is not None and (c.finalCode >= 300 or c.hungup is not None) for c in self.calls.values()):
+        break
+      r, w, x = select.select([self.sock], [], [], max(0, end - now))
+      if r:
+        data, addr = self.sock.recvfrom(65535)
+        self.receive(data)
+
+  def report(self):
+    calls = sorted(self.calls.values(), key=lambda c: c.index)
+    ringing = [c.ringing - c.start for c in calls if c.ringing is not None]
+    blocked = [c.final - c.start for c in calls if c.finalCode is not None and c.finalCode < 300]
+    rejected = [c for c in calls if c.finalCode is not None and c.finalCode >= 300 and c.finalCode != 487]
+    through = [c for c in calls if c.finalCode is None or c.finalCode == 487]
+    for c in calls:
+      print("%s ringing=%s final=%s code=%s" % (c.number,
+        "-" if c.ringing is None else "%.0fms" % ((c.ringing - c.start) * 1000),
+        "-" if c.final is None else "%.0fms" % ((c.final - c.start) * 1000),
+        "-" if c.finalCode is None else c.finalCode))
+    def stats(values):
+      if len(values) == 0: return "-"
+      return "avg %.0fms, max %.0fms" % (sum(values) * 1000 / len(values), max(values) * 1000)
+    print("calls:    %d" % len(calls))
+    print("ringing:  %d (%s)" % (len(ringing), stats(ringing)))
+    print("blocked:  %d (%s)" % (len(blocked), stats(blocked)))
+    print("rejected: %d" % len(rejected))
+    print("through:  %d" % len(through))
+
+
+#
+# main
+#
+def main(argv):
+  global g_debug
+  parser = argparse.ArgumentParser(description="Load test, sends parallel SIP calls to callblockerd")
+  parser.add_argument("--host", help="address of callblockerd", default="127.0.0.1")
+  parser.add_argument("--port", help="SIP port of callblockerd", type=int, default=5060)
+  parser.add_argument("--local-host", help="address to send from", default="127.0.0.1")
+  parser.add_argument("--local-port", help="port to send from", type=int, default=0)
+  parser.add_argument("--user", help="called user", default="callblocker")
+  parser.add_argument("--number", help="calling numbers, the call index is appended", default="+4144123")
+  parser.add_argument("--calls", help="parallel calls", type=int, default=4)
+  parser.add_argument("--timeout", help="seconds a call may ring before it is cancelled", type=float, default=15)
+  parser.add_argument('--debug', action='store_true')
+  args = parser.parse_args()
+  g_debug = args.debug
+
+  test = LoadTest(args)
+  test.run()
+  test.report()
+  return 0
+
+if __name__ == "__main__":
+  sys.exit(main(sys.argv))
+